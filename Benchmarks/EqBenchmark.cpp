@@ -0,0 +1,120 @@
+// CPU cost of one deck's EQ and filter with every stage engaged, against the same cascade
+// run one channel at a time in plain scalar code, and the response at a few frequencies:
+//   g++ -O2 -std=c++17 -I.. EqBenchmark.cpp ../DeckEqualizer.cpp ../SimdSupport.cpp -o EqBenchmark
+//   cl /O2 /std:c++17 /EHsc /I.. EqBenchmark.cpp ..\DeckEqualizer.cpp ..\SimdSupport.cpp
+#include "DeckEqualizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 256;
+
+    // five fixed biquads, one channel after the other, as a straightforward version would do it
+    struct ScalarCascade {
+        float c[5][5] = {
+            { 1.01f, -1.95f, 0.94f, -1.95f, 0.96f },
+            { 1.02f, -1.80f, 0.80f, -1.80f, 0.82f },
+            { 0.98f, -1.60f, 0.66f, -1.58f, 0.64f },
+            { 0.02f, 0.04f, 0.02f, -1.56f, 0.64f },
+            { 0.02f, 0.04f, 0.02f, -1.70f, 0.78f } };
+        float s[2][5][2] = {};
+
+        void process(float* const* channels, int numChannels, int numSamples) {
+            for (int ch = 0; ch < numChannels; ++ch) {
+                for (int n = 0; n < numSamples; ++n) {
+                    float v = channels[ch][n];
+                    for (int k = 0; k < 5; ++k) {
+                        const float y = c[k][0] * v + s[ch][k][0];
+                        s[ch][k][0] = c[k][1] * v - c[k][3] * y + s[ch][k][1];
+                        s[ch][k][1] = c[k][2] * v - c[k][4] * y;
+                        v = y;
+                    }
+                    channels[ch][n] = v;
+                }
+            }
+        }
+    };
+
+    template <typename Processor>
+    double secondsFor(Processor& processor, std::vector<float>& left, std::vector<float>& right) {
+        double best = 1.0e30;
+        for (int r = 0; r < 5; ++r) {
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t done = 0; done + blockSize <= left.size(); done += blockSize) {
+                float* channels[2] = { left.data() + done, right.data() + done };
+                processor.process(channels, 2, blockSize);
+            }
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    double responseDb(DeckEqualizer& eq, double hz) {
+        const int length = (int)sampleRate;
+        std::vector<float> left(length), right(length);
+        for (int i = 0; i < length; ++i)
+            left[i] = right[i] = (float)std::sin(2.0 * pi * hz * i / sampleRate);
+
+        eq.reset();
+        for (int done = 0; done < length; done += blockSize) {
+            float* channels[2] = { left.data() + done, right.data() + done };
+            eq.process(channels, 2, std::min(blockSize, length - done));
+        }
+
+        // second half only, past the glide and the filters' settling
+        double energy = 0.0;
+        for (int i = length / 2; i < length; ++i)
+            energy += (double)left[i] * left[i];
+        return 10.0 * std::log10(energy / (length / 2) / 0.5);
+    }
+}
+
+int main() {
+    const size_t length = (size_t)sampleRate * 10;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+    std::vector<float> left(length), right(length);
+    for (size_t i = 0; i < length; ++i) {
+        left[i] = dist(rng);
+        right[i] = dist(rng);
+    }
+
+    DeckEqualizer eq;
+    eq.prepare(sampleRate, 2);
+    eq.setBandGainDb(DeckEqualizer::Band::Low, 3.0f);
+    eq.setBandGainDb(DeckEqualizer::Band::Mid, -6.0f);
+    eq.setBandGainDb(DeckEqualizer::Band::High, 2.0f);
+    eq.setFilterPosition(-0.4f);
+
+    ScalarCascade scalar;
+    auto l = left, r = right;
+    const double scalarSeconds = secondsFor(scalar, l, r);
+    l = left;
+    r = right;
+    const double eqSeconds = secondsFor(eq, l, r);
+
+    std::printf("stereo, %.0f Hz, blocks of %d, five stages\n", sampleRate, blockSize);
+    std::printf("  %-22s %10.3f%% of a core\n", "scalar per channel", 100.0 * scalarSeconds / ((double)length / sampleRate));
+    std::printf("  %-22s %10.3f%% of a core\n", "DeckEqualizer", 100.0 * eqSeconds / ((double)length / sampleRate));
+
+    DeckEqualizer kill;
+    kill.prepare(sampleRate, 2);
+    kill.setBandGainDb(DeckEqualizer::Band::Low, DeckEqualizer::killDb);
+    std::printf("\nlow kill:   50 Hz %+.1f dB, 1 kHz %+.1f dB, 5 kHz %+.1f dB\n",
+        responseDb(kill, 50.0), responseDb(kill, 1000.0), responseDb(kill, 5000.0));
+
+    DeckEqualizer filter;
+    filter.prepare(sampleRate, 2);
+    filter.setFilterPosition(0.6f);
+    std::printf("high-pass:  50 Hz %+.1f dB, 1 kHz %+.1f dB, 5 kHz %+.1f dB\n",
+        responseDb(filter, 50.0), responseDb(filter, 1000.0), responseDb(filter, 5000.0));
+    return 0;
+}
@@ -0,0 +1,107 @@
+// CPU cost of the master-bus true-peak limiter, and how close its output stays to the
+// ceiling as measured by a much finer reference (32x, 97-tap sinc):
+//   g++ -O2 -std=c++17 -I.. LimiterBenchmark.cpp ../TruePeakLimiter.cpp ../SimdSupport.cpp -o LimiterBenchmark
+//   cl /O2 /std:c++17 /EHsc /I.. LimiterBenchmark.cpp ..\TruePeakLimiter.cpp ..\SimdSupport.cpp
+#include "TruePeakLimiter.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+    constexpr double sampleRate = 48000.0;
+    constexpr float ceilingDb = -1.0f;
+
+    // band-limited noise at about +10 dBFS peak, so the limiter works hard all the time
+    std::vector<float> hotNoise(size_t length, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> dist(0.0f, 1.0f);
+        std::vector<float> white(length);
+        for (auto& s : white)
+            s = dist(rng);
+
+        // 31-tap low-pass at 15 kHz, roughly the top of real program material
+        std::vector<float> out(length, 0.0f);
+        const double cutoff = 15000.0 / (sampleRate / 2.0);
+        for (size_t i = 15; i + 15 < length; ++i) {
+            double sum = 0.0;
+            for (int k = -15; k <= 15; ++k) {
+                const double t = k * cutoff;
+                const double sinc = k == 0 ? 1.0 : std::sin(pi * t) / (pi * t);
+                sum += white[i + k] * sinc * cutoff * (0.5 + 0.5 * std::cos(pi * k / 16.0));
+            }
+            out[i] = (float)(sum * 1.2);
+        }
+        return out;
+    }
+
+    double referenceTruePeak(const std::vector<float>& x) {
+        double peak = 0.0;
+        for (size_t i = 48; i + 48 < x.size(); ++i) {
+            for (int p = 0; p < 32; ++p) {
+                const double t = (double)i + p / 32.0;
+                double sum = 0.0;
+                for (size_t k = i - 48; k <= i + 48; ++k) {
+                    const double a = t - (double)k;
+                    const double sinc = std::abs(a) < 1.0e-9 ? 1.0 : std::sin(pi * a) / (pi * a);
+                    sum += x[k] * sinc * (0.5 + 0.5 * std::cos(pi * a / 49.0));
+                }
+                peak = std::max(peak, std::abs(sum));
+            }
+        }
+        return peak;
+    }
+
+    void run(TruePeakLimiter& limiter, std::vector<float>& left, std::vector<float>& right, int blockSize) {
+        for (size_t done = 0; done < left.size(); done += (size_t)blockSize) {
+            const int n = (int)std::min((size_t)blockSize, left.size() - done);
+            float* channels[2] = { left.data() + done, right.data() + done };
+            limiter.process(channels, 2, n);
+        }
+    }
+}
+
+int main() {
+    std::printf("stereo, %.0f Hz, ceiling %.1f dBTP\n", sampleRate, ceilingDb);
+    std::printf("  %-12s %14s\n", "block size", "CPU % of core");
+
+    const size_t length = (size_t)sampleRate * 10;
+    const auto sourceLeft = hotNoise(length, 1);
+    const auto sourceRight = hotNoise(length, 2);
+
+    for (int blockSize : { 64, 128, 512 }) {
+        TruePeakLimiter limiter;
+        limiter.prepare(sampleRate, 2, blockSize);
+        limiter.setCeilingDb(ceilingDb);
+
+        double best = 1.0e30;
+        for (int r = 0; r < 5; ++r) {
+            auto left = sourceLeft;
+            auto right = sourceRight;
+            limiter.reset();
+            const auto start = std::chrono::steady_clock::now();
+            run(limiter, left, right, blockSize);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        std::printf("  %-12d %13.3f%%\n", blockSize, 100.0 * best / ((double)length / sampleRate));
+    }
+
+    // accuracy on two seconds; the reference is slow
+    TruePeakLimiter limiter;
+    limiter.prepare(sampleRate, 2, 512);
+    limiter.setCeilingDb(ceilingDb);
+    std::vector<float> left(sourceLeft.begin(), sourceLeft.begin() + (size_t)sampleRate * 2);
+    std::vector<float> right(sourceRight.begin(), sourceRight.begin() + (size_t)sampleRate * 2);
+    const double inputPeak = std::max(referenceTruePeak(left), referenceTruePeak(right));
+    run(limiter, left, right, 512);
+    const double outputPeak = std::max(referenceTruePeak(left), referenceTruePeak(right));
+
+    std::printf("\ntrue peak in %+.2f dBTP, out %+.2f dBTP, latency %d samples\n",
+        20.0 * std::log10(inputPeak), 20.0 * std::log10(outputPeak), limiter.getLatencySamples());
+    // driven this hard, the gain movement itself adds about a tenth of a dB
+    return outputPeak <= std::pow(10.0, (ceilingDb + 0.2) / 20.0) ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// The master mix: the generic per-deck path (clear the outputs, then add every routed deck
+// channel through RoutingMatrix::mixDeck) against the fused MixKernels specialisations, for
+// the output layouts and deck counts they cover, and a check that both give the same output:
+//   g++ -O2 -std=c++17 -I.. MixBenchmark.cpp ../MixKernels.cpp ../RoutingMatrix.cpp ../GainRamp.cpp ../SimdSupport.cpp -o MixBenchmark
+//   cl /O2 /std:c++17 /EHsc /I.. MixBenchmark.cpp ..\MixKernels.cpp ..\RoutingMatrix.cpp ..\GainRamp.cpp ..\SimdSupport.cpp
+#include "MixKernels.h"
+#include "RoutingMatrix.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 256;
+    constexpr int numBlocks = 200000;
+
+    // stereo and mono play each deck left to left and right to right (mono folds both in
+    // at half gain); 5.1 also sends them to the surrounds and half of each to centre and LFE
+    void setRoutes(RoutingMatrix& routing, int numDecks, int numOutputs) {
+        routing.clear();
+        for (int d = 0; d < numDecks; ++d) {
+            for (int ch = 0; ch < RoutingMatrix::maxDeckChannels; ++ch) {
+                if (numOutputs == 1) {
+                    routing.setGain(d, ch, 0, 0.5f);
+                    continue;
+                }
+                routing.setGain(d, ch, ch, 1.0f);
+                if (numOutputs == 6) {
+                    routing.setGain(d, ch, 2, 0.5f);
+                    routing.setGain(d, ch, 3, 0.5f);
+                    routing.setGain(d, ch, 4 + ch, 0.7f);
+                }
+            }
+        }
+    }
+
+    struct Result {
+        double seconds = 0.0;
+        std::vector<float> lastBlock;
+    };
+
+    // every other block moves one route, so both paths spend some blocks gliding
+    template <typename Mix>
+    Result run(int numDecks, int numOutputs, const std::vector<std::vector<float>>& decks, Mix&& mix) {
+        RoutingMatrix routing(numDecks);
+        setRoutes(routing, numDecks, numOutputs);
+
+        std::vector<std::vector<float>> outputs((size_t)numOutputs, std::vector<float>(blockSize));
+        std::vector<float*> outputPointers;
+        for (auto& out : outputs)
+            outputPointers.push_back(out.data());
+        std::vector<const float*> deckPointers;
+        for (auto& channel : decks)
+            deckPointers.push_back(channel.data());
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int b = 0; b < numBlocks; ++b) {
+            if (b % 2 == 0)
+                routing.setGain(0, 0, 0, (b % 4 == 0) ? 0.5f : 1.0f);
+            mix(routing, deckPointers.data(), outputPointers.data());
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        Result result;
+        result.seconds = elapsed.count();
+        for (auto& out : outputs)
+            result.lastBlock.insert(result.lastBlock.end(), out.begin(), out.end());
+        return result;
+    }
+}
+
+int main() {
+    std::printf("%d-sample blocks, %.0f Hz\n", blockSize, sampleRate);
+    std::printf("  %-8s %-6s %16s %16s %9s\n", "outputs", "decks", "generic % core", "fused % core", "speed-up");
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    bool identical = true;
+
+    for (int numOutputs : { 1, 2, 6 }) {
+        for (int numDecks : { 2, 4, 8 }) {
+            const int numInputs = numDecks * MixKernels::channelsPerDeck;
+            std::vector<std::vector<float>> decks((size_t)numInputs, std::vector<float>(blockSize));
+            for (auto& channel : decks)
+                for (auto& s : channel)
+                    s = dist(rng);
+
+            double bestGeneric = 1.0e30, bestFused = 1.0e30;
+            Result generic, fused;
+
+            for (int r = 0; r < 5; ++r) {
+                generic = run(numDecks, numOutputs, decks,
+                    [&](RoutingMatrix& routing, const float* const* in, float* const* out) {
+                        for (int o = 0; o < numOutputs; ++o)
+                            std::memset(out[o], 0, sizeof(float) * blockSize);
+                        for (int d = 0; d < numDecks; ++d)
+                            routing.mixDeck(d, in + d * MixKernels::channelsPerDeck, MixKernels::channelsPerDeck,
+                                            out, numOutputs, blockSize);
+                    });
+                bestGeneric = std::min(bestGeneric, generic.seconds);
+
+                const MixKernels::Function kernel = MixKernels::select(numDecks, numOutputs);
+                std::vector<MixKernels::Gain> gains((size_t)(numOutputs * numInputs));
+                fused = run(numDecks, numOutputs, decks,
+                    [&](RoutingMatrix& routing, const float* const* in, float* const* out) {
+                        for (int d = 0; d < numDecks; ++d)
+                            routing.advanceDeck(d, numOutputs, blockSize,
+                                                gains.data() + d * MixKernels::channelsPerDeck, numInputs);
+                        kernel(in, gains.data(), out, blockSize);
+                    });
+                bestFused = std::min(bestFused, fused.seconds);
+            }
+
+            // both add the same products in the same order
+            identical = identical && generic.lastBlock == fused.lastBlock;
+
+            const double audioSeconds = (double)numBlocks * blockSize / sampleRate;
+            std::printf("  %-8d %-6d %15.3f%% %15.3f%% %8.2fx\n", numOutputs, numDecks,
+                100.0 * bestGeneric / audioSeconds, 100.0 * bestFused / audioSeconds, bestGeneric / bestFused);
+        }
+    }
+
+    std::printf("\noutputs %s\n", identical ? "identical" : "differ");
+    return identical ? 0 : 1;
+}
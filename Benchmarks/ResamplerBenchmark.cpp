@@ -0,0 +1,165 @@
+// CPU cost and aliasing of the deck resampler presets against the interpolator that
+// AudioTransportSource used before (ResamplingAudioSource: linear interpolation with a
+// two-pole low-pass, reproduced below so this builds without JUCE):
+//   g++ -O2 -std=c++17 -I.. ResamplerBenchmark.cpp ../PolyphaseResampler.cpp ../SimdSupport.cpp -o ResamplerBenchmark
+//   cl /O2 /std:c++17 /EHsc /I.. ResamplerBenchmark.cpp ..\PolyphaseResampler.cpp ..\SimdSupport.cpp
+#include "PolyphaseResampler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+    constexpr int blockSize = 512;
+
+    // Linear interpolation plus the biquad ResamplingAudioSource puts in front of it when
+    // downsampling and behind it when upsampling.
+    class LinearBaseline
+    {
+    public:
+        explicit LinearBaseline(double inputPerOutput) : ratio(inputPerOutput) {
+            const double proportionalRate = ratio > 1.0 ? 0.5 / ratio : 0.5 * ratio;
+            const double n = 1.0 / std::tan(pi * std::max(0.001, proportionalRate));
+            const double nSquared = n * n;
+            const double c1 = 1.0 / (1.0 + std::sqrt(2.0) * n + nSquared);
+            b0 = c1; b1 = c1 * 2.0; b2 = c1;
+            a1 = c1 * 2.0 * (1.0 - nSquared);
+            a2 = c1 * (1.0 - std::sqrt(2.0) * n + nSquared);
+        }
+
+        std::vector<float> run(const std::vector<float>& input) {
+            std::vector<float> in(input);
+            if (ratio > 1.0001)
+                filter(in);
+
+            std::vector<float> out;
+            out.reserve((size_t)(input.size() / ratio) + 1);
+            for (double pos = 0.0; pos + 1.0 < (double)in.size(); pos += ratio) {
+                const size_t i = (size_t)pos;
+                const float alpha = (float)(pos - (double)i);
+                out.push_back(in[i] + alpha * (in[i + 1] - in[i]));
+            }
+
+            if (ratio <= 1.0001)
+                filter(out);
+            return out;
+        }
+
+    private:
+        void filter(std::vector<float>& x) {
+            double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+            for (auto& s : x) {
+                const double y = b0 * s + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+                x2 = x1; x1 = s; y2 = y1; y1 = y;
+                s = (float)y;
+            }
+        }
+
+        double ratio;
+        double b0, b1, b2, a1, a2;
+    };
+
+    std::vector<float> runPolyphase(const std::vector<float>& input, double ratio, PolyphaseResampler::Quality q) {
+        PolyphaseResampler r;
+        r.setQuality(q);
+        r.setRatio(ratio);
+        r.prepare(2, blockSize);
+
+        std::vector<float> out;
+        std::vector<float> l(blockSize), rr(blockSize);
+        float* outs[2] = { l.data(), rr.data() };
+        size_t consumed = 0;
+
+        // stereo with the same signal on both sides, so the cost is that of a real deck
+        while (true) {
+            const int needed = r.getInputNeeded(blockSize);
+            if (consumed + (size_t)needed > input.size())
+                break;
+            const float* ins[2] = { input.data() + consumed, input.data() + consumed };
+            r.process(ins, needed, outs, blockSize);
+            consumed += (size_t)needed;
+            out.insert(out.end(), l.begin(), l.end());
+        }
+        return out;
+    }
+
+    std::vector<float> sine(double freq, double rate, size_t length) {
+        std::vector<float> x(length);
+        for (size_t i = 0; i < length; ++i)
+            x[i] = (float)(0.5 * std::sin(2.0 * pi * freq * (double)i / rate));
+        return x;
+    }
+
+    // level of everything except a sine at freq, relative to a full 0.5 amplitude sine, in dB;
+    // the first and last few thousand samples are skipped to leave out filter start-up
+    double residualDb(const std::vector<float>& y, double freq, double rate, bool keepTone) {
+        const size_t from = 4096, to = y.size() > 8192 ? y.size() - 4096 : y.size();
+        double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+        for (size_t i = from; i < to; ++i) {
+            const double s = std::sin(2.0 * pi * freq * (double)i / rate), c = std::cos(2.0 * pi * freq * (double)i / rate);
+            ss += s * s; sc += s * c; cc += c * c; ys += y[i] * s; yc += y[i] * c;
+        }
+        const double det = ss * cc - sc * sc;
+        const double a = keepTone ? (ys * cc - yc * sc) / det : 0.0;
+        const double b = keepTone ? (yc * ss - ys * sc) / det : 0.0;
+
+        double err = 0.0;
+        for (size_t i = from; i < to; ++i) {
+            const double e = y[i] - a * std::sin(2.0 * pi * freq * (double)i / rate) - b * std::cos(2.0 * pi * freq * (double)i / rate);
+            err += e * e;
+        }
+        const double rms = std::sqrt(err / (double)(to - from));
+        return 20.0 * std::log10(std::max(1.0e-12, rms / (0.5 / std::sqrt(2.0))));
+    }
+
+    template <typename Fn>
+    double secondsPerAudioSecond(Fn&& fn, double audioSeconds) {
+        double best = 1.0e30;
+        for (int r = 0; r < 5; ++r) {
+            const auto start = std::chrono::steady_clock::now();
+            fn();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best / audioSeconds;
+    }
+}
+
+int main() {
+    struct Case { const char* name; double inRate, outRate, testTone; bool toneIsWanted; };
+    const Case cases[] = {
+        // upsampling: how much besides the 15 kHz tone comes out (images, interpolation error)
+        { "44.1k -> 48k, 15 kHz tone, residual", 44100.0, 48000.0, 15000.0, true },
+        // downsampling: a 23 kHz tone is above the new Nyquist and should vanish entirely
+        { "48k -> 44.1k, 23 kHz tone, alias   ", 48000.0, 44100.0, 23000.0, false },
+    };
+
+    const size_t length = 48000 * 10;
+
+    for (const auto& c : cases) {
+        const double ratio = c.inRate / c.outRate;
+        const auto input = sine(c.testTone, c.inRate, length);
+        const double audioSeconds = (double)length / c.inRate;
+
+        std::printf("%s\n", c.name);
+        std::printf("  %-26s %10s %12s\n", "resampler", "dB", "CPU % / deck");
+
+        LinearBaseline baseline(ratio);
+        std::vector<float> y;
+        double cost = secondsPerAudioSecond([&] { y = baseline.run(input); }, audioSeconds);
+        std::printf("  %-26s %10.1f %11.3f%%\n", "linear + 2-pole (before)", residualDb(y, c.testTone, c.outRate, c.toneIsWanted), cost * 100.0);
+
+        const PolyphaseResampler::Quality qualities[] = { PolyphaseResampler::Quality::Low,
+            PolyphaseResampler::Quality::Medium, PolyphaseResampler::Quality::High };
+        const char* names[] = { "polyphase Low (16 taps)", "polyphase Medium (48 taps)", "polyphase High (96 taps)" };
+
+        for (int q = 0; q < 3; ++q) {
+            cost = secondsPerAudioSecond([&] { y = runPolyphase(input, ratio, qualities[q]); }, audioSeconds);
+            std::printf("  %-26s %10.1f %11.3f%%\n", names[q], residualDb(y, c.testTone, c.outRate, c.toneIsWanted), cost * 100.0);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "Crossfader.h"
+
+namespace
+{
+    // short enough to follow a scratch, long enough to hide the steps of a mouse drag
+    constexpr double crossfaderRampSeconds = 0.005;
+
+    // width of the fade region at each end of the cut curve
+    constexpr float cutWidth = 0.05f;
+}
+
+void Crossfader::setPosition(float newPosition) {
+    position = juce::jlimit(0.0f, 1.0f, newPosition);
+}
+
+void Crossfader::setCurve(Curve newCurve) {
+    curve = (int)newCurve;
+}
+
+void Crossfader::getGains(Curve curve, float x, float& gainA, float& gainB) {
+    switch (curve) {
+    case Curve::Linear:
+        gainA = 1.0f - x;
+        gainB = x;
+        break;
+
+    case Curve::Cut:
+        gainA = juce::jlimit(0.0f, 1.0f, (1.0f - x) / cutWidth);
+        gainB = juce::jlimit(0.0f, 1.0f, x / cutWidth);
+        break;
+
+    case Curve::ConstantPower:
+    default:
+        gainA = std::cos(x * juce::MathConstants<float>::halfPi);
+        gainB = std::sin(x * juce::MathConstants<float>::halfPi);
+        break;
+    }
+}
+
+void Crossfader::prepareToPlay(double sampleRate) {
+    float gainA, gainB;
+    getGains(getCurve(), getPosition(), gainA, gainB);
+
+    rampA.prepare(sampleRate, crossfaderRampSeconds);
+    rampB.prepare(sampleRate, crossfaderRampSeconds);
+    rampA.setCurrentAndTarget(gainA);
+    rampB.setCurrentAndTarget(gainB);
+}
+
+void Crossfader::advance(int numSamples, GainRamp::Block& blockA, GainRamp::Block& blockB) {
+    float gainA, gainB;
+    getGains(getCurve(), getPosition(), gainA, gainB);
+
+    rampA.setTarget(gainA);
+    rampB.setTarget(gainB);
+    blockA = rampA.advance(numSamples);
+    blockB = rampB.advance(numSamples);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <JuceHeader.h>
+#include "GainRamp.h"
+
+// The master-mix crossfader between deck A (0.0) and deck B (1.0). The GUI sets the
+// position and curve; the audio thread turns them into two smoothed gain ramps once
+// per block.
+class Crossfader
+{
+public:
+    enum class Curve {
+        Linear,        // -6 dB in the middle, for blends between related material
+        ConstantPower, // equal loudness all the way across
+        Cut            // both decks at full level except right at the edges, for scratching
+    };
+
+    // message thread
+    void setPosition(float newPosition);
+    float getPosition() const { return position.load(); }
+    void setCurve(Curve newCurve);
+    Curve getCurve() const { return (Curve)curve.load(); }
+
+    static void getGains(Curve curve, float position, float& gainA, float& gainB);
+
+    // audio thread
+    void prepareToPlay(double sampleRate);
+    void advance(int numSamples, GainRamp::Block& blockA, GainRamp::Block& blockB);
+
+private:
+    std::atomic<float> position{ 0.5f };
+    std::atomic<int> curve{ (int)Curve::ConstantPower };
+
+    GainRamp rampA;
+    GainRamp rampB;
+};
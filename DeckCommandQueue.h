@@ -0,0 +1,112 @@
+#pragma once
+#include <JuceHeader.h>
+
+// A transport or parameter change posted by the message thread and applied by the
+// audio thread at the start of the next block, or at an exact master clock sample.
+struct DeckCommand {
+    enum class Type {
+        Play,
+        Pause,
+        Stop,
+        Restart,
+        Seek,
+        SeekNormalized,
+        SeekSample,
+        SeekRelative,
+        SeekToEnd,
+        JumpAndPlay,
+        SetGain,
+        SetSpeed,
+        SetEqLow,
+        SetEqMid,
+        SetEqHigh,
+        SetFilter,
+        SetReverse,
+        SetEffectLayout,
+        SetEffectParameter,
+        ScrubStart,
+        ScrubEnd
+    };
+
+    Type type = Type::Play;
+    double value = 0.0;
+
+    // transport commands from before the last loadFile() refer to a different track and are dropped
+    int epoch = 0;
+
+    // increases by one per posted command, so published deck state can tell which ones it includes
+    juce::uint32 serial = 0;
+
+    // MasterClock sample to apply at; -1 applies at the start of the next block
+    juce::int64 atSample = -1;
+
+    // effect and parameter the command addresses, for SetEffectParameter
+    int index = 0;
+
+    // true for transport commands that reposition the playhead; volume, tempo, tone and
+    // effect changes leave it where it is
+    bool movesPlayhead() const {
+        switch (type) {
+        case Type::Stop:
+        case Type::Restart:
+        case Type::Seek:
+        case Type::SeekNormalized:
+        case Type::SeekSample:
+        case Type::SeekRelative:
+        case Type::SeekToEnd:
+        case Type::JumpAndPlay:
+        case Type::ScrubEnd:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool isTransport() const {
+        return movesPlayhead() || type == Type::Play || type == Type::Pause || type == Type::ScrubStart;
+    }
+};
+
+// Wait-free single-producer/single-consumer queue of DeckCommands. The message thread is
+// the only producer, the audio thread the only consumer; neither side ever blocks.
+class DeckCommandQueue {
+public:
+    explicit DeckCommandQueue(int capacity = 256)
+        : fifo(capacity), commands((size_t)capacity) {
+    }
+
+    bool push(const DeckCommand& command) {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 + size2 == 0) {
+            jassertfalse; // the audio thread is not draining; the command is lost
+            return false;
+        }
+
+        commands[(size_t)(size1 > 0 ? start1 : start2)] = command;
+        fifo.finishedWrite(1);
+        return true;
+    }
+
+    // consumer side; true if a drain() would apply anything
+    bool hasPending() const { return fifo.getNumReady() > 0; }
+
+    template <typename Function>
+    void drain(Function&& apply) {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            apply(commands[(size_t)(start1 + i)]);
+        for (int i = 0; i < size2; ++i)
+            apply(commands[(size_t)(start2 + i)]);
+
+        fifo.finishedRead(size1 + size2);
+    }
+
+private:
+    juce::AbstractFifo fifo;
+    std::vector<DeckCommand> commands;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckCommandQueue)
+};
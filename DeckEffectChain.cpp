@@ -0,0 +1,440 @@
+#include "DeckEffectChain.h"
+#include <algorithm>
+#include <cmath>
+
+// One insert. prepare() may allocate; nothing else may.
+class DeckEffectChain::InsertEffect
+{
+public:
+    virtual ~InsertEffect() = default;
+    virtual void prepare(double sampleRate, int numChannels) = 0;
+    virtual void reset() = 0;
+    virtual void setParameter(int index, float value) = 0;
+    virtual void process(float* const* channels, int numChannels, int numSamples) = 0;
+};
+
+namespace
+{
+    // Feedback echo with a smoothed, interpolated delay time, so moving it glides like tape.
+    class DelayEffect : public DeckEffectChain::InsertEffect
+    {
+    public:
+        void prepare(double newSampleRate, int numChannels) override {
+            sampleRate = newSampleRate;
+            const int needed = (int)std::ceil(DeckEffectChain::maxDelaySeconds * sampleRate) + 4;
+            lines.setSize(numChannels, juce::nextPowerOfTwo(needed));
+            mask = lines.getNumSamples() - 1;
+            smoothing = 1.0 - std::exp(-1.0 / (0.05 * sampleRate));
+            targetDelay = delaySeconds * sampleRate;
+            reset();
+        }
+
+        void reset() override {
+            lines.clear();
+            writeIndex = 0;
+            currentDelay = targetDelay;
+        }
+
+        void setParameter(int index, float value) override {
+            if (index == 0) {
+                delaySeconds = juce::jlimit(0.01, DeckEffectChain::maxDelaySeconds, (double)value);
+                targetDelay = delaySeconds * sampleRate;
+            }
+            else if (index == 1) {
+                feedback = juce::jlimit(0.0f, 0.95f, value);
+            }
+            else if (index == 2) {
+                mix = juce::jlimit(0.0f, 1.0f, value);
+            }
+        }
+
+        void process(float* const* channels, int numChannels, int numSamples) override {
+            numChannels = juce::jmin(numChannels, lines.getNumChannels());
+            float* line[DeckEffectChain::maxChannels] = {};
+            for (int ch = 0; ch < numChannels; ++ch)
+                line[ch] = lines.getWritePointer(ch);
+
+            for (int i = 0; i < numSamples; ++i) {
+                currentDelay += (targetDelay - currentDelay) * smoothing;
+                const double readPosition = writeIndex - currentDelay;
+                const int index = (int)std::floor(readPosition);
+                const float frac = (float)(readPosition - index);
+
+                for (int ch = 0; ch < numChannels; ++ch) {
+                    const float a = line[ch][index & mask];
+                    const float echo = a + (line[ch][(index + 1) & mask] - a) * frac;
+                    const float x = channels[ch][i];
+                    line[ch][writeIndex] = x + feedback * echo;
+                    channels[ch][i] = x + mix * echo;
+                }
+                writeIndex = (writeIndex + 1) & mask;
+            }
+        }
+
+    private:
+        juce::AudioBuffer<float> lines;
+        int mask = 0;
+        int writeIndex = 0;
+        double sampleRate = 44100.0;
+        double smoothing = 1.0;
+        double delaySeconds = 0.375;
+        double targetDelay = 0.0;
+        double currentDelay = 0.0;
+        float feedback = 0.4f;
+        float mix = 0.35f;
+    };
+
+    // JUCE's Freeverb, which smooths its own parameter changes.
+    class ReverbEffect : public DeckEffectChain::InsertEffect
+    {
+    public:
+        ReverbEffect() {
+            parameters.roomSize = 0.6f;
+            parameters.damping = 0.5f;
+            parameters.width = 1.0f;
+            parameters.dryLevel = 0.5f; // unity after Freeverb's internal scaling
+            setMix(0.25f);
+        }
+
+        void prepare(double sampleRate, int) override {
+            reverb.setSampleRate(sampleRate);
+            reverb.setParameters(parameters);
+            reverb.reset();
+        }
+
+        void reset() override { reverb.reset(); }
+
+        void setParameter(int index, float value) override {
+            value = juce::jlimit(0.0f, 1.0f, value);
+            if (index == 0)
+                parameters.roomSize = value;
+            else if (index == 1)
+                parameters.damping = value;
+            else if (index == 2)
+                setMix(value);
+            reverb.setParameters(parameters);
+        }
+
+        void process(float* const* channels, int numChannels, int numSamples) override {
+            if (numChannels >= 2)
+                reverb.processStereo(channels[0], channels[1], numSamples);
+            else if (numChannels == 1)
+                reverb.processMono(channels[0], numSamples);
+        }
+
+    private:
+        void setMix(float mix) { parameters.wetLevel = mix / 3.0f; }
+
+        juce::Reverb reverb;
+        juce::Reverb::Parameters parameters;
+    };
+
+    // Resonant state-variable filter (topology-preserving transform), so the cutoff can be
+    // swept without the blow-ups of a direct-form biquad.
+    class FilterEffect : public DeckEffectChain::InsertEffect
+    {
+    public:
+        void prepare(double newSampleRate, int numChannels) override {
+            sampleRate = newSampleRate;
+            state.assign((size_t)numChannels * 2, 0.0f);
+            smoothing = (float)(1.0 - std::exp(-updateInterval / (0.03 * sampleRate)));
+            currentCutoff = targetCutoff;
+            updateCoefficients();
+        }
+
+        void reset() override {
+            std::fill(state.begin(), state.end(), 0.0f);
+            currentCutoff = targetCutoff;
+            updateCoefficients();
+        }
+
+        void setParameter(int index, float value) override {
+            if (index == 0) {
+                targetCutoff = juce::jlimit(20.0f, 20000.0f, value);
+            }
+            else if (index == 1) {
+                resonance = juce::jlimit(0.0f, 1.0f, value);
+                updateCoefficients();
+            }
+            else if (index == 2) {
+                mode = juce::jlimit(0, 2, (int)value);
+            }
+        }
+
+        void process(float* const* channels, int numChannels, int numSamples) override {
+            numChannels = juce::jmin(numChannels, (int)state.size() / 2);
+
+            for (int done = 0; done < numSamples; done += updateInterval) {
+                if (currentCutoff != targetCutoff) {
+                    // glide in log frequency, one coefficient update per 32 samples
+                    const float ratio = targetCutoff / currentCutoff;
+                    currentCutoff = std::abs(ratio - 1.0f) < 0.001f ? targetCutoff
+                                                                    : currentCutoff * std::pow(ratio, smoothing);
+                    updateCoefficients();
+                }
+
+                const int n = juce::jmin(updateInterval, numSamples - done);
+                for (int ch = 0; ch < numChannels; ++ch) {
+                    float* data = channels[ch] + done;
+                    float ic1 = state[(size_t)ch * 2];
+                    float ic2 = state[(size_t)ch * 2 + 1];
+
+                    for (int i = 0; i < n; ++i) {
+                        const float x = data[i];
+                        const float v3 = x - ic2;
+                        const float v1 = a1 * ic1 + a2 * v3;
+                        const float v2 = ic2 + a2 * ic1 + a3 * v3;
+                        ic1 = 2.0f * v1 - ic1;
+                        ic2 = 2.0f * v2 - ic2;
+                        data[i] = mode == 0 ? v2 : mode == 1 ? v1 : x - k * v1 - v2;
+                    }
+
+                    state[(size_t)ch * 2] = ic1;
+                    state[(size_t)ch * 2 + 1] = ic2;
+                }
+            }
+        }
+
+    private:
+        static constexpr int updateInterval = 32;
+
+        void updateCoefficients() {
+            const double g = std::tan(juce::MathConstants<double>::pi * juce::jmin((double)currentCutoff, 0.45 * sampleRate) / sampleRate);
+            const double q = 0.707 * std::pow(14.0, (double)resonance);
+            k = (float)(1.0 / q);
+            a1 = (float)(1.0 / (1.0 + g * (g + k)));
+            a2 = (float)(g * a1);
+            a3 = (float)(g * a2);
+        }
+
+        std::vector<float> state;
+        double sampleRate = 44100.0;
+        float smoothing = 1.0f;
+        float targetCutoff = 1000.0f;
+        float currentCutoff = 1000.0f;
+        float resonance = 0.3f;
+        int mode = 0;
+        float k = 1.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+    };
+
+    // Noise gate keyed on the loudest channel, with a short hold so it does not chatter.
+    class GateEffect : public DeckEffectChain::InsertEffect
+    {
+    public:
+        void prepare(double newSampleRate, int) override {
+            sampleRate = newSampleRate;
+            attack = (float)(1.0 - std::exp(-1.0 / (0.001 * sampleRate)));
+            holdLength = (int)(0.02 * sampleRate);
+            setParameter(1, releaseSeconds);
+            reset();
+        }
+
+        void reset() override {
+            gain = 1.0f;
+            holdRemaining = 0;
+        }
+
+        void setParameter(int index, float value) override {
+            if (index == 0) {
+                threshold = juce::Decibels::decibelsToGain(juce::jlimit(-80.0f, 0.0f, value));
+            }
+            else if (index == 1) {
+                releaseSeconds = juce::jlimit(0.005f, 2.0f, value);
+                release = (float)(1.0 - std::exp(-1.0 / (releaseSeconds * sampleRate)));
+            }
+        }
+
+        void process(float* const* channels, int numChannels, int numSamples) override {
+            for (int i = 0; i < numSamples; ++i) {
+                float peak = 0.0f;
+                for (int ch = 0; ch < numChannels; ++ch)
+                    peak = juce::jmax(peak, std::abs(channels[ch][i]));
+
+                if (peak >= threshold)
+                    holdRemaining = holdLength;
+                else if (holdRemaining > 0)
+                    --holdRemaining;
+
+                const float target = holdRemaining > 0 ? 1.0f : 0.0f;
+                gain += (target - gain) * (target > gain ? attack : release);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    channels[ch][i] *= gain;
+            }
+        }
+
+    private:
+        double sampleRate = 44100.0;
+        float threshold = 0.01f;
+        float releaseSeconds = 0.08f;
+        float attack = 1.0f;
+        float release = 1.0f;
+        int holdLength = 0;
+        int holdRemaining = 0;
+        float gain = 1.0f;
+    };
+}
+
+int DeckEffectChain::Layout::pack() const {
+    int packed = 0;
+    for (int slot = 0; slot < numEffects; ++slot)
+        packed |= (int)order[(size_t)slot] << (slot * 2);
+    for (int e = 0; e < numEffects; ++e)
+        packed |= (enabled[(size_t)e] ? 1 : 0) << (8 + e);
+    return packed;
+}
+
+DeckEffectChain::Layout DeckEffectChain::Layout::unpack(int packed) {
+    Layout result;
+    int seen = 0;
+    for (int slot = 0; slot < numEffects; ++slot) {
+        const int e = (packed >> (slot * 2)) & 3;
+        result.order[(size_t)slot] = (Effect)e;
+        seen |= 1 << e;
+    }
+    if (seen != (1 << numEffects) - 1)
+        result.order = Layout().order;
+
+    for (int e = 0; e < numEffects; ++e)
+        result.enabled[(size_t)e] = ((packed >> (8 + e)) & 1) != 0;
+    return result;
+}
+
+void DeckEffectChain::Layout::moveTo(Effect effect, int slot) {
+    const auto from = std::find(order.begin(), order.end(), effect);
+    const auto to = order.begin() + juce::jlimit(0, numEffects - 1, slot);
+    if (from < to)
+        std::rotate(from, from + 1, to + 1);
+    else if (to < from)
+        std::rotate(to, from, from + 1);
+}
+
+DeckEffectChain::DeckEffectChain() {
+    effects[(size_t)Effect::Delay] = std::make_unique<DelayEffect>();
+    effects[(size_t)Effect::Reverb] = std::make_unique<ReverbEffect>();
+    effects[(size_t)Effect::Filter] = std::make_unique<FilterEffect>();
+    effects[(size_t)Effect::Gate] = std::make_unique<GateEffect>();
+}
+
+DeckEffectChain::~DeckEffectChain() = default;
+
+void DeckEffectChain::prepare(double sampleRate, int maxBlockSize, int numChannels) {
+    channels = juce::jlimit(1, maxChannels, numChannels);
+    fadeLength = juce::jmax(1, (int)(0.005 * sampleRate));
+    dryBuffer.setSize(channels, juce::jmax(256, maxBlockSize));
+
+    for (auto& effect : effects)
+        effect->prepare(sampleRate, channels);
+    reset();
+}
+
+void DeckEffectChain::reset() {
+    for (int e = 0; e < numEffects; ++e) {
+        effects[(size_t)e]->reset();
+        stages[(size_t)e] = layout.enabled[(size_t)e] ? Stage::On : Stage::Off;
+        fadePosition[(size_t)e] = 0;
+    }
+    updateRunningCount();
+}
+
+void DeckEffectChain::setLayout(const Layout& newLayout) {
+    for (int e = 0; e < numEffects; ++e) {
+        auto& stage = stages[(size_t)e];
+        auto& position = fadePosition[(size_t)e];
+
+        if (newLayout.enabled[(size_t)e]) {
+            if (stage == Stage::Off) {
+                // starts from silence rather than whatever it held when it was switched off
+                effects[(size_t)e]->reset();
+                position = 0;
+                stage = Stage::FadingIn;
+            }
+            else if (stage == Stage::FadingOut) {
+                position = fadeLength - position;
+                stage = Stage::FadingIn;
+            }
+        }
+        else {
+            if (stage == Stage::On) {
+                position = 0;
+                stage = Stage::FadingOut;
+            }
+            else if (stage == Stage::FadingIn) {
+                position = fadeLength - position;
+                stage = Stage::FadingOut;
+            }
+        }
+    }
+
+    layout = newLayout;
+    updateRunningCount();
+}
+
+void DeckEffectChain::setParameter(Effect effect, Parameter parameter, float value) {
+    effects[(size_t)effect]->setParameter((int)parameter, value);
+}
+
+void DeckEffectChain::process(float* const* channelData, int numChannels, int numSamples) {
+    if (numRunning == 0)
+        return;
+
+    juce::ScopedNoDenormals noDenormals;
+    numChannels = juce::jmin(numChannels, channels);
+
+    for (const Effect effect : layout.order) {
+        const int e = (int)effect;
+        switch (stages[(size_t)e]) {
+        case Stage::Off:
+            break;
+        case Stage::On:
+            effects[(size_t)e]->process(channelData, numChannels, numSamples);
+            break;
+        case Stage::FadingIn:
+        case Stage::FadingOut:
+            processFading(e, channelData, numChannels, numSamples);
+            break;
+        }
+    }
+}
+
+// runs the effect and crossfades its output against the dry signal; a fade can span blocks
+void DeckEffectChain::processFading(int e, float* const* channelData, int numChannels, int numSamples) {
+    auto& stage = stages[(size_t)e];
+    auto& position = fadePosition[(size_t)e];
+    const bool fadingIn = stage == Stage::FadingIn;
+    float* chunkData[maxChannels] = {};
+
+    for (int done = 0; done < numSamples; done += dryBuffer.getNumSamples()) {
+        const int n = juce::jmin(dryBuffer.getNumSamples(), numSamples - done);
+        for (int ch = 0; ch < numChannels; ++ch) {
+            chunkData[ch] = channelData[ch] + done;
+            dryBuffer.copyFrom(ch, 0, chunkData[ch], n);
+        }
+
+        effects[(size_t)e]->process(chunkData, numChannels, n);
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            const float* dry = dryBuffer.getReadPointer(ch);
+            float* wet = chunkData[ch];
+            for (int i = 0; i < n; ++i) {
+                const float t = juce::jmin(1.0f, (float)(position + i) / (float)fadeLength);
+                const float g = fadingIn ? t : 1.0f - t;
+                wet[i] = dry[i] + (wet[i] - dry[i]) * g;
+            }
+        }
+        position += n;
+    }
+
+    if (position >= fadeLength) {
+        position = 0;
+        stage = fadingIn ? Stage::On : Stage::Off;
+        updateRunningCount();
+    }
+}
+
+void DeckEffectChain::updateRunningCount() {
+    numRunning = 0;
+    for (const Stage stage : stages)
+        if (stage != Stage::Off)
+            ++numRunning;
+}
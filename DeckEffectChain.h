@@ -0,0 +1,96 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+// Insert effects for one deck: delay, reverb, resonant filter and gate, in an order and
+// with bypass states the GUI can change while playing. Every effect and every buffer is
+// created up front and sized in prepare(); the audio thread only ever swaps in a new
+// Layout between blocks, so a block costs the same whatever was changed before it.
+//
+// Effects switched on or off are crossfaded over a few milliseconds against the dry
+// signal. A reorder takes effect instantly; delay, reverb and filter are linear, so only
+// moving the gate across them changes what comes out.
+class DeckEffectChain
+{
+public:
+    enum class Effect {
+        Delay,
+        Reverb,
+        Filter,
+        Gate
+    };
+    static constexpr int numEffects = 4;
+
+    // per-effect parameters; values are in the units named
+    enum class Parameter {
+        DelayTime = 0,     // seconds, 0.01 to maxDelaySeconds
+        DelayFeedback = 1, // 0 to 0.95
+        DelayMix = 2,      // 0 to 1, level of the echoes on top of the dry signal
+        ReverbSize = 0,    // 0 to 1
+        ReverbDamping = 1, // 0 to 1
+        ReverbMix = 2,     // 0 to 1
+        FilterCutoff = 0,  // Hz
+        FilterResonance = 1, // 0 to 1
+        FilterMode = 2,    // 0 low-pass, 1 band-pass, 2 high-pass
+        GateThreshold = 0, // dB
+        GateRelease = 1    // seconds
+    };
+    static constexpr int maxParameters = 3;
+    static constexpr double maxDelaySeconds = 2.0;
+    static constexpr int maxChannels = 8;
+
+    // which effect runs in which slot, and which are switched on; packs into an int so it
+    // travels through the deck command queue as one value
+    struct Layout {
+        std::array<Effect, numEffects> order{ Effect::Gate, Effect::Filter, Effect::Delay, Effect::Reverb };
+        std::array<bool, numEffects> enabled{};
+
+        int pack() const;
+        static Layout unpack(int packed);
+        void moveTo(Effect effect, int slot);
+    };
+
+    DeckEffectChain();
+    ~DeckEffectChain();
+
+    // allocates; call before the first process()
+    void prepare(double sampleRate, int maxBlockSize, int numChannels);
+    void reset();
+
+    // audio thread, between blocks
+    void setLayout(const Layout& newLayout);
+    void setParameter(Effect effect, Parameter parameter, float value);
+
+    // false while every effect is off and nothing is fading
+    bool isActive() const { return numRunning > 0; }
+
+    // in place; channels beyond the prepared count are left alone
+    void process(float* const* channels, int numChannels, int numSamples);
+
+    class InsertEffect;
+
+private:
+    enum class Stage {
+        Off,
+        FadingIn,
+        On,
+        FadingOut
+    };
+
+    void processFading(int index, float* const* channels, int numChannels, int numSamples);
+    void updateRunningCount();
+
+    std::array<std::unique_ptr<InsertEffect>, numEffects> effects;
+    std::array<Stage, numEffects> stages{};
+    std::array<int, numEffects> fadePosition{};
+    Layout layout;
+    int numRunning = 0;
+
+    int channels = 2;
+    int fadeLength = 256;
+
+    // dry copy of the block while an effect fades
+    juce::AudioBuffer<float> dryBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckEffectChain)
+};
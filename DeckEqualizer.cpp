@@ -0,0 +1,259 @@
+#include "DeckEqualizer.h"
+#include "SimdSupport.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+
+    constexpr double lowShelfHz = 200.0;
+    constexpr double midPeakHz = 1000.0;
+    constexpr double midPeakQ = 0.5;
+    constexpr double highShelfHz = 3000.0;
+
+    // filter sweep ends, and the Butterworth Qs of the two sections
+    constexpr double lowPassTopHz = 18000.0;
+    constexpr double lowPassBottomHz = 60.0;
+    constexpr double highPassBottomHz = 20.0;
+    constexpr double highPassTopHz = 8000.0;
+    constexpr double filterQ[2] = { 0.5412, 1.3066 };
+    constexpr float filterDeadZone = 0.02f;
+
+    constexpr double smoothingSeconds = 0.03;
+
+    struct Raw {
+        double b0, b1, b2, a0, a1, a2;
+    };
+
+    void normalise(const Raw& r, float& b0, float& b1, float& b2, float& a1, float& a2) {
+        b0 = (float)(r.b0 / r.a0);
+        b1 = (float)(r.b1 / r.a0);
+        b2 = (float)(r.b2 / r.a0);
+        a1 = (float)(r.a1 / r.a0);
+        a2 = (float)(r.a2 / r.a0);
+    }
+
+    // RBJ audio EQ cookbook, shelves with slope 1
+    Raw shelf(double sampleRate, double hz, float gainDb, bool high) {
+        const double a = std::pow(10.0, gainDb / 40.0);
+        const double w0 = 2.0 * pi * hz / sampleRate;
+        const double c = std::cos(w0);
+        const double twoSqrtAAlpha = 2.0 * std::sqrt(a) * std::sin(w0) / 2.0 * std::sqrt(2.0);
+        const double sign = high ? -1.0 : 1.0;
+
+        return { a * ((a + 1.0) - sign * (a - 1.0) * c + twoSqrtAAlpha),
+                 sign * 2.0 * a * ((a - 1.0) - sign * (a + 1.0) * c),
+                 a * ((a + 1.0) - sign * (a - 1.0) * c - twoSqrtAAlpha),
+                 (a + 1.0) + sign * (a - 1.0) * c + twoSqrtAAlpha,
+                 -sign * 2.0 * ((a - 1.0) + sign * (a + 1.0) * c),
+                 (a + 1.0) + sign * (a - 1.0) * c - twoSqrtAAlpha };
+    }
+
+    Raw peak(double sampleRate, double hz, double q, float gainDb) {
+        const double a = std::pow(10.0, gainDb / 40.0);
+        const double w0 = 2.0 * pi * hz / sampleRate;
+        const double alpha = std::sin(w0) / (2.0 * q);
+        const double c = std::cos(w0);
+        return { 1.0 + alpha * a, -2.0 * c, 1.0 - alpha * a, 1.0 + alpha / a, -2.0 * c, 1.0 - alpha / a };
+    }
+
+    Raw pass(double sampleRate, double hz, double q, bool high) {
+        const double w0 = 2.0 * pi * std::min(hz, 0.45 * sampleRate) / sampleRate;
+        const double alpha = std::sin(w0) / (2.0 * q);
+        const double c = std::cos(w0);
+        const double b0 = high ? (1.0 + c) / 2.0 : (1.0 - c) / 2.0;
+        return { b0, high ? -(1.0 + c) : 1.0 - c, b0, 1.0 + alpha, -2.0 * c, 1.0 - alpha };
+    }
+
+}
+
+void DeckEqualizer::prepare(double newSampleRate, int numChannels) {
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    channels = std::min(std::max(1, numChannels), maxChannels);
+    smoothing = (float)(1.0 - std::exp(-updateInterval / (smoothingSeconds * sampleRate)));
+
+    // jump straight to the knob positions; nothing is playing yet
+    std::copy(std::begin(targetGainDb), std::end(targetGainDb), currentGainDb);
+    currentFilter = targetFilter;
+    moving = false;
+    updateCoefficients();
+    reset();
+}
+
+void DeckEqualizer::reset() {
+    std::memset(state, 0, sizeof(state));
+}
+
+void DeckEqualizer::setBandGainDb(Band band, float gainDb) {
+    targetGainDb[(int)band] = std::min(maxBoostDb, std::max(killDb, gainDb));
+    moving = true;
+}
+
+void DeckEqualizer::setFilterPosition(float position) {
+    targetFilter = std::min(1.0f, std::max(-1.0f, position));
+    moving = true;
+}
+
+void DeckEqualizer::advanceSmoothing() {
+    bool stillMoving = false;
+
+    for (int b = 0; b < 3; ++b) {
+        const float diff = targetGainDb[b] - currentGainDb[b];
+        if (std::abs(diff) < 0.01f) {
+            currentGainDb[b] = targetGainDb[b];
+        }
+        else {
+            currentGainDb[b] += diff * smoothing;
+            stillMoving = true;
+        }
+    }
+
+    const float diff = targetFilter - currentFilter;
+    if (std::abs(diff) < 0.0005f) {
+        currentFilter = targetFilter;
+    }
+    else {
+        currentFilter += diff * smoothing;
+        stillMoving = true;
+    }
+
+    moving = stillMoving;
+}
+
+void DeckEqualizer::updateCoefficients() {
+    Raw raw[numStages];
+    bool active[numStages] = {};
+
+    active[LowShelf] = std::abs(currentGainDb[0]) >= 0.01f;
+    active[MidPeak] = std::abs(currentGainDb[1]) >= 0.01f;
+    active[HighShelf] = std::abs(currentGainDb[2]) >= 0.01f;
+    active[Filter1] = active[Filter2] = std::abs(currentFilter) >= filterDeadZone;
+
+    if (active[LowShelf])
+        raw[LowShelf] = shelf(sampleRate, lowShelfHz, currentGainDb[0], false);
+    if (active[MidPeak])
+        raw[MidPeak] = peak(sampleRate, midPeakHz, midPeakQ, currentGainDb[1]);
+    if (active[HighShelf])
+        raw[HighShelf] = shelf(sampleRate, highShelfHz, currentGainDb[2], true);
+
+    if (active[Filter1]) {
+        // exponential sweep, so equal knob moves sound like equal steps
+        const bool high = currentFilter > 0.0f;
+        const double amount = (std::abs(currentFilter) - filterDeadZone) / (1.0 - filterDeadZone);
+        const double hz = high ? highPassBottomHz * std::pow(highPassTopHz / highPassBottomHz, amount)
+                               : lowPassTopHz * std::pow(lowPassBottomHz / lowPassTopHz, amount);
+        raw[Filter1] = pass(sampleRate, hz, filterQ[0], high);
+        raw[Filter2] = pass(sampleRate, hz, filterQ[1], high);
+    }
+
+    numActiveStages = 0;
+    for (int s = 0; s < numStages; ++s) {
+        if (!active[s]) {
+            // a flat stage holds no signal; it restarts from silence when it comes back
+            coefficients[s] = Coefficients();
+            std::memset(state[s], 0, sizeof(state[s]));
+            continue;
+        }
+        auto& c = coefficients[s];
+        normalise(raw[s], c.b0, c.b1, c.b2, c.a1, c.a2);
+        activeStages[numActiveStages++] = s;
+    }
+}
+
+void DeckEqualizer::process(float* const* channelData, int numChannels, int numSamples) {
+    numChannels = std::min(numChannels, channels);
+
+    for (int done = 0; done < numSamples; done += updateInterval) {
+        if (moving) {
+            advanceSmoothing();
+            updateCoefficients();
+        }
+
+        if (numActiveStages == 0 && !moving)
+            return;
+
+        processChunk(channelData, numChannels, done, std::min(updateInterval, numSamples - done));
+    }
+}
+
+void DeckEqualizer::processChunk(float* const* channelData, int numChannels, int offset, int numSamples) {
+    if (numActiveStages == 0)
+        return;
+
+    int i = 0;
+
+   #if SIMDSUPPORT_X86
+    // every channel in its own lane; four samples are transposed in, run through the whole
+    // cascade one after another, and transposed back out
+    __m128 c[numStages][5], s1[numStages], s2[numStages];
+    for (int k = 0; k < numActiveStages; ++k) {
+        const int s = activeStages[k];
+        const auto& co = coefficients[s];
+        c[k][0] = _mm_set1_ps(co.b0);
+        c[k][1] = _mm_set1_ps(co.b1);
+        c[k][2] = _mm_set1_ps(co.b2);
+        c[k][3] = _mm_set1_ps(co.a1);
+        c[k][4] = _mm_set1_ps(co.a2);
+        s1[k] = _mm_load_ps(state[s][0]);
+        s2[k] = _mm_load_ps(state[s][1]);
+    }
+
+    float* lane[maxChannels];
+    float silent[4] = {};
+    for (int ch = 0; ch < maxChannels; ++ch)
+        lane[ch] = ch < numChannels ? channelData[ch] + offset : nullptr;
+
+    for (; i + 4 <= numSamples; i += 4) {
+        __m128 r0 = lane[0] != nullptr ? _mm_loadu_ps(lane[0] + i) : _mm_load_ps(silent);
+        __m128 r1 = lane[1] != nullptr ? _mm_loadu_ps(lane[1] + i) : _mm_load_ps(silent);
+        __m128 r2 = lane[2] != nullptr ? _mm_loadu_ps(lane[2] + i) : _mm_load_ps(silent);
+        __m128 r3 = lane[3] != nullptr ? _mm_loadu_ps(lane[3] + i) : _mm_load_ps(silent);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        __m128* x[4] = { &r0, &r1, &r2, &r3 };
+        for (int n = 0; n < 4; ++n) {
+            __m128 v = *x[n];
+            for (int k = 0; k < numActiveStages; ++k) {
+                const __m128 y = _mm_add_ps(_mm_mul_ps(c[k][0], v), s1[k]);
+                s1[k] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c[k][1], v), _mm_mul_ps(c[k][3], y)), s2[k]);
+                s2[k] = _mm_sub_ps(_mm_mul_ps(c[k][2], v), _mm_mul_ps(c[k][4], y));
+                v = y;
+            }
+            *x[n] = v;
+        }
+
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        if (lane[0] != nullptr) _mm_storeu_ps(lane[0] + i, r0);
+        if (lane[1] != nullptr) _mm_storeu_ps(lane[1] + i, r1);
+        if (lane[2] != nullptr) _mm_storeu_ps(lane[2] + i, r2);
+        if (lane[3] != nullptr) _mm_storeu_ps(lane[3] + i, r3);
+    }
+
+    for (int k = 0; k < numActiveStages; ++k) {
+        _mm_store_ps(state[activeStages[k]][0], s1[k]);
+        _mm_store_ps(state[activeStages[k]][1], s2[k]);
+    }
+   #endif
+
+    // the remainder, or everything without SSE2
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* data = channelData[ch] + offset;
+        for (int n = i; n < numSamples; ++n) {
+            float v = data[n];
+            for (int k = 0; k < numActiveStages; ++k) {
+                const int s = activeStages[k];
+                const auto& co = coefficients[s];
+                float& s1 = state[s][0][ch];
+                float& s2 = state[s][1][ch];
+                const float y = co.b0 * v + s1;
+                s1 = co.b1 * v - co.a1 * y + s2;
+                s2 = co.b2 * v - co.a2 * y;
+                v = y;
+            }
+            data[n] = v;
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// DJ-style tone control for one deck: low shelf, mid peak and high shelf that go from a
+// +6 dB boost down to a -40 dB kill, then a one-knob filter that sweeps a 4th-order
+// low-pass (knob left) or high-pass (knob right) and is off in the centre.
+//
+// All stages are biquads in transposed direct form II, run as one cascade with every
+// channel in its own SSE2 lane. Knob moves are smoothed and the coefficients recomputed
+// every 32 samples while anything is moving. Stages at 0 dB or with the filter centred
+// are skipped, so a flat deck costs nothing. Free of JUCE so the benchmark can build it.
+class DeckEqualizer
+{
+public:
+    enum class Band {
+        Low,
+        Mid,
+        High
+    };
+
+    static constexpr float killDb = -40.0f;
+    static constexpr float maxBoostDb = 6.0f;
+    static constexpr int maxChannels = 4;
+
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+
+    // audio thread; both glide to the new value
+    void setBandGainDb(Band band, float gainDb);
+    // -1 is the lowest low-pass cutoff, +1 the highest high-pass cutoff, 0 is off
+    void setFilterPosition(float position);
+
+    // false when every stage is flat and settled
+    bool isActive() const { return numActiveStages > 0 || moving; }
+
+    // in place; channels beyond maxChannels are left alone
+    void process(float* const* channels, int numChannels, int numSamples);
+
+private:
+    enum Stage { LowShelf, MidPeak, HighShelf, Filter1, Filter2, numStages };
+
+    struct Coefficients {
+        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+    };
+
+    static constexpr int updateInterval = 32;
+
+    void advanceSmoothing();
+    void updateCoefficients();
+    void processChunk(float* const* channels, int numChannels, int offset, int numSamples);
+
+    double sampleRate = 44100.0;
+    int channels = 2;
+    float smoothing = 1.0f;
+
+    float targetGainDb[3] = { 0.0f, 0.0f, 0.0f };
+    float currentGainDb[3] = { 0.0f, 0.0f, 0.0f };
+    float targetFilter = 0.0f;
+    float currentFilter = 0.0f;
+    bool moving = false;
+
+    Coefficients coefficients[numStages];
+    int activeStages[numStages] = {};
+    int numActiveStages = 0;
+
+    // s1 and s2 per stage, one lane per channel
+    alignas(16) float state[numStages][2][maxChannels] = {};
+};
@@ -0,0 +1,93 @@
+#include "DeckRenderPool.h"
+
+class DeckRenderPool::Worker : public juce::Thread
+{
+public:
+    Worker(DeckRenderPool& ownerPool, int index)
+        : juce::Thread("Deck render " + juce::String(index + 1)), owner(ownerPool) {}
+
+    void run() override {
+        while (!threadShouldExit()) {
+            wake.wait(-1);
+            if (threadShouldExit())
+                break;
+
+            // a late wake-up simply helps with whatever block is current
+            owner.runJobs((juce::uint32)(owner.nextJob.load(std::memory_order_acquire) >> 32));
+        }
+    }
+
+    void stop() {
+        signalThreadShouldExit();
+        wake.signal();
+        stopThread(2000);
+    }
+
+    juce::WaitableEvent wake;
+
+private:
+    DeckRenderPool& owner;
+};
+
+DeckRenderPool::DeckRenderPool(int numWorkers) {
+    for (int i = 0; i < numWorkers; ++i) {
+        auto* worker = workers.add(new Worker(*this, i));
+        worker->startRealtimeThread(juce::Thread::RealtimeOptions{});
+    }
+}
+
+DeckRenderPool::~DeckRenderPool() {
+    for (auto* worker : workers)
+        worker->stop();
+}
+
+void DeckRenderPool::setJob(Job newJob) {
+    job = std::move(newJob);
+}
+
+int DeckRenderPool::getDefaultNumWorkers(int numDecks) {
+    // the audio thread renders too, and one core is left for the GUI and disk threads
+    return juce::jlimit(0, 15, juce::jmin(numDecks - 1, juce::SystemStats::getNumCpus() - 2));
+}
+
+void DeckRenderPool::run(int numJobs) {
+    if (numJobs <= 0 || !job)
+        return;
+
+    ++currentBlock;
+    jobCount.store(numJobs, std::memory_order_relaxed);
+    jobsRemaining.store(numJobs, std::memory_order_relaxed);
+    nextJob.store((juce::uint64)currentBlock << 32, std::memory_order_release);
+
+    const int toWake = juce::jmin(workers.size(), numJobs - 1);
+    for (int i = 0; i < toWake; ++i)
+        workers.getUnchecked(i)->wake.signal();
+
+    runJobs(currentBlock);
+
+    // the last jobs are usually already running on a worker; wait for them without sleeping
+    for (int spins = 0; jobsRemaining.load(std::memory_order_acquire) > 0; ++spins)
+        if (spins > 64)
+            juce::Thread::yield();
+}
+
+void DeckRenderPool::runJobs(juce::uint32 block) {
+    auto claimed = nextJob.load(std::memory_order_acquire);
+
+    for (;;) {
+        if ((juce::uint32)(claimed >> 32) != block)
+            return;
+
+        const int index = (int)(claimed & 0xffffffffu);
+        if (index >= jobCount.load(std::memory_order_relaxed))
+            return;
+
+        // fails if another thread took this job or a new block has started
+        if (!nextJob.compare_exchange_weak(claimed, claimed + 1, std::memory_order_acq_rel))
+            continue;
+
+        job(index);
+        jobsRemaining.fetch_sub(1, std::memory_order_acq_rel);
+        claimed = nextJob.load(std::memory_order_acquire);
+    }
+}
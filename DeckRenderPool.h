@@ -0,0 +1,47 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+
+// Runs one job per deck on a set of worker threads that sleep between audio callbacks.
+// The audio thread wakes the workers, claims jobs itself too, and returns once every
+// job of the block has finished, so the final mix can follow straight away.
+//
+// Jobs are claimed through a single atomic that carries a block counter in its high
+// half, so a worker that wakes late can never pick up a job from a finished block.
+class DeckRenderPool
+{
+public:
+    using Job = std::function<void(int jobIndex)>;
+
+    // numWorkers extra threads; 0 renders everything on the calling thread
+    explicit DeckRenderPool(int numWorkers);
+    ~DeckRenderPool();
+
+    // set before audio starts; the job runs on the audio thread and the workers
+    void setJob(Job newJob);
+
+    int getNumWorkers() const { return workers.size(); }
+
+    // audio thread: runs job(0) .. job(numJobs - 1) and waits for all of them
+    void run(int numJobs);
+
+    // a sensible worker count for the machine and the given number of decks
+    static int getDefaultNumWorkers(int numDecks);
+
+private:
+    class Worker;
+
+    // claims and runs jobs of the given block until none are left
+    void runJobs(juce::uint32 block);
+
+    Job job;
+    juce::OwnedArray<Worker> workers;
+
+    std::atomic<juce::uint64> nextJob{ 0 }; // block << 32 | next job index
+    std::atomic<int> jobCount{ 0 };
+    std::atomic<int> jobsRemaining{ 0 };
+    juce::uint32 currentBlock = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckRenderPool)
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <JuceHeader.h>
+
+// What the audio thread knew about a deck at the end of its last block.
+struct DeckState {
+    double positionSeconds = 0.0;
+    double lengthSeconds = 0.0;
+    // the same in the track's own samples, exact however long the track is
+    juce::int64 positionSamples = 0;
+    bool playing = false;
+
+    // the command epoch, and the serial up to which every command had been applied (or
+    // dropped) when this was published; one waiting for its master clock sample holds it back
+    int epoch = 0;
+    juce::uint32 lastCommand = 0;
+};
+
+// Triple buffer: the audio thread publishes a complete DeckState every block without
+// waiting, and the message thread always reads the newest complete one. One writer
+// thread and one reader thread only.
+class DeckStateSnapshot {
+public:
+    DeckStateSnapshot() {
+    }
+
+    // audio thread
+    DeckState& getWriteState() { return slots[back]; }
+
+    void publish() {
+        back = middle.exchange(back | newDataFlag) & indexMask;
+    }
+
+    // message thread
+    const DeckState& read() const {
+        if (middle.load() & newDataFlag)
+            front = middle.exchange(front) & indexMask;
+        return slots[front];
+    }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+
+    DeckState slots[3];
+    int back = 0;
+    std::atomic<int> middle{ 1 };
+    mutable int front = 2;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckStateSnapshot)
+};
@@ -0,0 +1,37 @@
+#include "DecodedTrackAudioSource.h"
+
+DecodedTrackAudioSource::DecodedTrackAudioSource(std::shared_ptr<const DecodedTrack> decodedTrack)
+    : track(std::move(decodedTrack))
+{
+    jassert(track != nullptr);
+}
+
+DecodedTrackAudioSource::~DecodedTrackAudioSource() {
+}
+
+void DecodedTrackAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    (void)samplesPerBlockExpected;
+    (void)sampleRate;
+}
+
+void DecodedTrackAudioSource::releaseResources() {
+}
+
+void DecodedTrackAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    const auto& samples = track->samples;
+    const juce::int64 start = position.load();
+    const juce::int64 available = juce::jmax((juce::int64)0, (juce::int64)samples.getNumSamples() - start);
+    const int num = (int)juce::jmin((juce::int64)bufferToFill.numSamples, available);
+
+    auto& dest = *bufferToFill.buffer;
+    for (int ch = 0; ch < dest.getNumChannels(); ++ch) {
+        // mono tracks feed every output channel
+        if (num > 0)
+            dest.copyFrom(ch, bufferToFill.startSample, samples,
+                juce::jmin(ch, samples.getNumChannels() - 1), (int)start, num);
+        if (num < bufferToFill.numSamples)
+            dest.clear(ch, bufferToFill.startSample + num, bufferToFill.numSamples - num);
+    }
+
+    position = start + bufferToFill.numSamples;
+}
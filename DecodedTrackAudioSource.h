@@ -0,0 +1,30 @@
+#pragma once
+#include <JuceHeader.h>
+#include "DecodedTrackCache.h"
+
+// Plays a track straight out of the decoded-track cache. Every read is a copy from RAM,
+// so seeking costs nothing and no read-ahead stage is needed in front of it.
+class DecodedTrackAudioSource : public juce::PositionableAudioSource
+{
+public:
+    explicit DecodedTrackAudioSource(std::shared_ptr<const DecodedTrack> decodedTrack);
+    ~DecodedTrackAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override { position = juce::jmax((juce::int64)0, newPosition); }
+    juce::int64 getNextReadPosition() const override { return position.load(); }
+    juce::int64 getTotalLength() const override { return track->samples.getNumSamples(); }
+    bool isLooping() const override { return false; }
+
+    double getSampleRate() const { return track->sampleRate; }
+    int getNumChannels() const { return track->samples.getNumChannels(); }
+
+private:
+    std::shared_ptr<const DecodedTrack> track;
+    std::atomic<juce::int64> position{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedTrackAudioSource)
+};
@@ -0,0 +1,179 @@
+#include "DecodedTrackCache.h"
+#include "Mp3FrameIndex.h"
+#include "Wave64AudioFormat.h"
+
+class DecodedTrackCache::DecodeJob : public juce::ThreadPoolJob
+{
+public:
+    DecodeJob(DecodedTrackCache& o, const juce::File& f, const juce::String& k)
+        : juce::ThreadPoolJob("Decode track"), owner(o), file(f), key(k) {
+    }
+
+    JobStatus runJob() override {
+        owner.decode(file, key, *this);
+        return jobHasFinished;
+    }
+
+private:
+    DecodedTrackCache& owner;
+    juce::File file;
+    juce::String key;
+};
+
+DecodedTrackCache::DecodedTrackCache() {
+    formatManager.registerBasicFormats();
+    formatManager.registerFormat(new Wave64AudioFormat(), false);
+}
+
+DecodedTrackCache::~DecodedTrackCache() {
+    decodePool.removeAllJobs(true, 5000);
+}
+
+juce::String DecodedTrackCache::makeKey(const juce::File& file) {
+    return file.getFullPathName() + "|" + juce::String(file.getLastModificationTime().toMilliseconds());
+}
+
+juce::int64 DecodedTrackCache::getSizeInBytes(const DecodedTrack& track) {
+    return (juce::int64)track.samples.getNumChannels() * track.samples.getNumSamples() * (juce::int64)sizeof(float);
+}
+
+void DecodedTrackCache::setMemoryBudget(juce::int64 bytes) {
+    const juce::ScopedLock sl(lock);
+    budgetBytes = juce::jmax((juce::int64)0, bytes);
+    evictUntilFits(0);
+}
+
+juce::int64 DecodedTrackCache::getMemoryBudget() const {
+    const juce::ScopedLock sl(lock);
+    return budgetBytes;
+}
+
+juce::int64 DecodedTrackCache::getMemoryUsed() const {
+    const juce::ScopedLock sl(lock);
+    return usedBytes;
+}
+
+int DecodedTrackCache::getNumTracks() const {
+    const juce::ScopedLock sl(lock);
+    return (int)entries.size();
+}
+
+std::shared_ptr<const DecodedTrack> DecodedTrackCache::find(const juce::File& file) {
+    const juce::String key = makeKey(file);
+
+    const juce::ScopedLock sl(lock);
+    for (auto& entry : entries) {
+        if (entry.key == key) {
+            entry.lastUsed = ++useCounter;
+            return entry.track;
+        }
+    }
+    return nullptr;
+}
+
+void DecodedTrackCache::requestDecode(const juce::File& file) {
+    const juce::String key = makeKey(file);
+
+    {
+        const juce::ScopedLock sl(lock);
+        if (budgetBytes <= 0 || pendingKeys.contains(key))
+            return;
+        for (auto& entry : entries)
+            if (entry.key == key)
+                return;
+        pendingKeys.add(key);
+    }
+
+    decodePool.addJob(new DecodeJob(*this, file, key), true);
+}
+
+void DecodedTrackCache::clear() {
+    const juce::ScopedLock sl(lock);
+    entries.clear();
+    usedBytes = 0;
+}
+
+// Runs on the decode thread.
+void DecodedTrackCache::decode(const juce::File& file, const juce::String& key, juce::ThreadPoolJob& job) {
+    std::shared_ptr<DecodedTrack> track;
+
+    // same reader as streaming playback, so both number an MP3's samples alike
+    if (auto reader = Mp3FrameIndex::createReader(formatManager, file, nullptr)) {
+        // the decks play stereo, so wider files are stored as their first two channels
+        const int channels = juce::jlimit(1, 2, (int)reader->numChannels);
+        const juce::int64 length = reader->lengthInSamples;
+        const juce::int64 bytes = (juce::int64)channels * length * (juce::int64)sizeof(float);
+
+        if (length > 0 && length <= std::numeric_limits<int>::max() && reserve(bytes)) {
+            track = std::make_shared<DecodedTrack>();
+            track->sampleRate = reader->sampleRate;
+            track->samples.setSize(channels, (int)length, false, false, false);
+
+            const int chunk = 1 << 16;
+            for (int pos = 0; pos < (int)length && track != nullptr; pos += chunk) {
+                if (job.shouldExit())
+                    track.reset();
+                else
+                    reader->read(&track->samples, pos, juce::jmin(chunk, (int)length - pos), pos, true, channels > 1);
+            }
+
+            if (track != nullptr)
+                insert(key, std::move(track));
+            else
+                unreserve(bytes);
+        }
+    }
+
+    const juce::ScopedLock sl(lock);
+    pendingKeys.removeString(key);
+}
+
+// Makes room for a track before its buffer is allocated, so the cache never holds more than
+// its budget even while decoding. False if the track is over its share of the budget.
+bool DecodedTrackCache::reserve(juce::int64 bytes) {
+    const juce::ScopedLock sl(lock);
+    if (bytes > budgetBytes / maxTrackShare)
+        return false;
+
+    evictUntilFits(bytes);
+    reservedBytes += bytes;
+    return true;
+}
+
+void DecodedTrackCache::unreserve(juce::int64 bytes) {
+    const juce::ScopedLock sl(lock);
+    reservedBytes -= bytes;
+}
+
+// Takes over the space reserve() held for the track.
+void DecodedTrackCache::insert(const juce::String& key, std::shared_ptr<const DecodedTrack> track) {
+    const juce::int64 bytes = getSizeInBytes(*track);
+
+    const juce::ScopedLock sl(lock);
+    reservedBytes -= bytes;
+
+    // the budget may have been lowered while it was decoding
+    if (bytes > budgetBytes / maxTrackShare)
+        return;
+
+    evictUntilFits(bytes);
+
+    Entry entry;
+    entry.key = key;
+    entry.track = std::move(track);
+    entry.bytes = bytes;
+    entry.lastUsed = ++useCounter;
+    entries.push_back(std::move(entry));
+    usedBytes += bytes;
+}
+
+// Caller holds the lock. Decks still playing an evicted track keep their shared_ptr.
+void DecodedTrackCache::evictUntilFits(juce::int64 incomingBytes) {
+    while (!entries.empty() && usedBytes + reservedBytes + incomingBytes > budgetBytes) {
+        auto oldest = std::min_element(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+        usedBytes -= oldest->bytes;
+        entries.erase(oldest);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <JuceHeader.h>
+
+// A whole track decoded to float PCM.
+struct DecodedTrack {
+    juce::AudioBuffer<float> samples;
+    double sampleRate = 0.0;
+};
+
+// Keeps recently played tracks fully decoded in RAM, keyed by path and modification
+// time, and evicts the least recently used ones once the byte budget is exceeded.
+// Misses are decoded on the cache's own background thread so the next load is instant.
+// Off until a budget is set. All methods are thread-safe.
+class DecodedTrackCache
+{
+public:
+    DecodedTrackCache();
+    ~DecodedTrackCache();
+
+    // 0 disables the cache and drops everything it holds
+    void setMemoryBudget(juce::int64 bytes);
+
+    // no single track may take more than this share of the budget, so one long track
+    // cannot push out the whole working set
+    static constexpr int maxTrackShare = 4;
+    juce::int64 getMemoryBudget() const;
+    juce::int64 getMemoryUsed() const;
+    int getNumTracks() const;
+
+    // nullptr on a miss; the returned track stays valid even if it is evicted meanwhile
+    std::shared_ptr<const DecodedTrack> find(const juce::File& file);
+
+    // decodes the file in the background unless it is cached or already being decoded
+    void requestDecode(const juce::File& file);
+
+    void clear();
+
+private:
+    class DecodeJob;
+
+    struct Entry {
+        juce::String key;
+        std::shared_ptr<const DecodedTrack> track;
+        juce::int64 bytes = 0;
+        juce::uint64 lastUsed = 0;
+    };
+
+    static juce::String makeKey(const juce::File& file);
+    static juce::int64 getSizeInBytes(const DecodedTrack& track);
+
+    void decode(const juce::File& file, const juce::String& key, juce::ThreadPoolJob& job);
+    bool reserve(juce::int64 bytes);
+    void unreserve(juce::int64 bytes);
+    void insert(const juce::String& key, std::shared_ptr<const DecodedTrack> track);
+    void evictUntilFits(juce::int64 incomingBytes);
+
+    juce::AudioFormatManager formatManager;
+
+    mutable juce::CriticalSection lock;
+    std::vector<Entry> entries;
+    juce::StringArray pendingKeys;
+    juce::int64 budgetBytes = 0;
+    juce::int64 usedBytes = 0;
+    // held for the track being decoded, so older ones are evicted before it is allocated
+    juce::int64 reservedBytes = 0;
+    juce::uint64 useCounter = 0;
+
+    // below the state it touches, so its jobs are stopped before that goes away
+    juce::ThreadPool decodePool{ 1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodedTrackCache)
+};
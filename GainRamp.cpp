@@ -0,0 +1,161 @@
+#include "GainRamp.h"
+#include "SimdSupport.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // gain for sample i is start + i * step in every kernel, so they all agree bit for bit
+
+    void applyScalar(float* data, int begin, int numSamples, float start, float step) {
+        for (int i = begin; i < numSamples; ++i)
+            data[i] *= start + (float)i * step;
+    }
+
+    void addScalar(float* dest, const float* src, int begin, int numSamples, float start, float step) {
+        for (int i = begin; i < numSamples; ++i)
+            dest[i] += src[i] * (start + (float)i * step);
+    }
+
+#if SIMDSUPPORT_X86
+    void applySse2(float* data, int numSamples, float start, float step) {
+        const __m128 s = _mm_set1_ps(start);
+        const __m128 st = _mm_set1_ps(step);
+        const __m128 four = _mm_set1_ps(4.0f);
+        __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4) {
+            const __m128 gain = _mm_add_ps(s, _mm_mul_ps(index, st));
+            _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), gain));
+            index = _mm_add_ps(index, four);
+        }
+        applyScalar(data, i, numSamples, start, step);
+    }
+
+    void addSse2(float* dest, const float* src, int numSamples, float start, float step) {
+        const __m128 s = _mm_set1_ps(start);
+        const __m128 st = _mm_set1_ps(step);
+        const __m128 four = _mm_set1_ps(4.0f);
+        __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4) {
+            const __m128 gain = _mm_add_ps(s, _mm_mul_ps(index, st));
+            _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_mul_ps(_mm_loadu_ps(src + i), gain)));
+            index = _mm_add_ps(index, four);
+        }
+        addScalar(dest, src, i, numSamples, start, step);
+    }
+
+    SIMDSUPPORT_AVX2 void applyAvx2(float* data, int numSamples, float start, float step) {
+        const __m256 s = _mm256_set1_ps(start);
+        const __m256 st = _mm256_set1_ps(step);
+        const __m256 eight = _mm256_set1_ps(8.0f);
+        __m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8) {
+            const __m256 gain = _mm256_add_ps(s, _mm256_mul_ps(index, st));
+            _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), gain));
+            index = _mm256_add_ps(index, eight);
+        }
+        applyScalar(data, i, numSamples, start, step);
+    }
+
+    SIMDSUPPORT_AVX2 void addAvx2(float* dest, const float* src, int numSamples, float start, float step) {
+        const __m256 s = _mm256_set1_ps(start);
+        const __m256 st = _mm256_set1_ps(step);
+        const __m256 eight = _mm256_set1_ps(8.0f);
+        __m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8) {
+            const __m256 gain = _mm256_add_ps(s, _mm256_mul_ps(index, st));
+            _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), gain)));
+            index = _mm256_add_ps(index, eight);
+        }
+        addScalar(dest, src, i, numSamples, start, step);
+    }
+#endif
+
+    void applyRamp(float* data, int numSamples, float start, float step) {
+       #if SIMDSUPPORT_X86
+        if (SimdSupport::hasAvx2())
+            applyAvx2(data, numSamples, start, step);
+        else
+            applySse2(data, numSamples, start, step);
+       #else
+        applyScalar(data, 0, numSamples, start, step);
+       #endif
+    }
+
+    void addRamp(float* dest, const float* src, int numSamples, float start, float step) {
+       #if SIMDSUPPORT_X86
+        if (SimdSupport::hasAvx2())
+            addAvx2(dest, src, numSamples, start, step);
+        else
+            addSse2(dest, src, numSamples, start, step);
+       #else
+        addScalar(dest, src, 0, numSamples, start, step);
+       #endif
+    }
+}
+
+void GainRamp::prepare(double sampleRate, double rampSeconds) {
+    rampSamples = std::max(1, (int)std::lround(sampleRate * rampSeconds));
+    setCurrentAndTarget(target);
+}
+
+void GainRamp::setTarget(float newTarget) {
+    if (newTarget == target)
+        return;
+
+    target = newTarget;
+    remaining = rampSamples;
+    step = (target - current) / (float)rampSamples;
+}
+
+void GainRamp::setCurrentAndTarget(float gain) {
+    current = target = gain;
+    remaining = 0;
+    step = 0.0f;
+}
+
+GainRamp::Block GainRamp::advance(int numSamples) {
+    Block block;
+    block.start = current;
+
+    if (remaining > 0 && numSamples > 0) {
+        const int length = std::min(remaining, numSamples);
+        block.step = step;
+        block.rampLength = length;
+        remaining -= length;
+        current = remaining > 0 ? current + step * (float)length : target;
+    }
+
+    block.end = current;
+    return block;
+}
+
+void GainRamp::apply(const Block& block, float* data, int numSamples) {
+    const int ramp = std::min(block.rampLength, numSamples);
+    if (ramp > 0)
+        applyRamp(data, ramp, block.start, block.step);
+
+    const int rest = numSamples - ramp;
+    if (rest <= 0 || block.end == 1.0f)
+        return;
+
+    if (block.end == 0.0f)
+        std::memset(data + ramp, 0, sizeof(float) * (size_t)rest);
+    else
+        applyRamp(data + ramp, rest, block.end, 0.0f);
+}
+
+void GainRamp::add(const Block& block, float* dest, const float* src, int numSamples, float scale) {
+    const int ramp = std::min(block.rampLength, numSamples);
+    if (ramp > 0)
+        addRamp(dest, src, ramp, block.start * scale, block.step * scale);
+
+    const int rest = numSamples - ramp;
+    if (rest > 0 && block.end != 0.0f)
+        addRamp(dest + ramp, src + ramp, rest, block.end * scale, 0.0f);
+}
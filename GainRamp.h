@@ -0,0 +1,40 @@
+#pragma once
+
+// A gain that glides linearly to each new target over a fixed number of samples. The
+// audio thread asks for one Block per buffer and hands it to apply()/add(), which run
+// the ramped part and the steady part as separate SSE2/AVX2 loops, so the per-sample
+// path has no branches. Free of JUCE so the benchmark can build it on its own.
+class GainRamp
+{
+public:
+    // gain is start + i * step for the first rampLength samples, then end
+    struct Block {
+        float start = 1.0f;
+        float step = 0.0f;
+        int rampLength = 0;
+        float end = 1.0f;
+    };
+
+    void prepare(double sampleRate, double rampSeconds);
+
+    // audio thread only
+    void setTarget(float newTarget);
+    void setCurrentAndTarget(float gain);
+    float getTarget() const { return target; }
+    bool isRamping() const { return remaining > 0; }
+
+    // the gains for the next numSamples samples; moves the ramp forward
+    Block advance(int numSamples);
+
+    // data *= gain
+    static void apply(const Block& block, float* data, int numSamples);
+    // dest += src * gain * scale
+    static void add(const Block& block, float* dest, const float* src, int numSamples, float scale = 1.0f);
+
+private:
+    int rampSamples = 1;
+    int remaining = 0;
+    float current = 1.0f;
+    float target = 1.0f;
+    float step = 0.0f;
+};
@@ -0,0 +1,225 @@
+#include "LoopingAudioSource.h"
+
+LoopingAudioSource::LoopingAudioSource(juce::PositionableAudioSource* inputSource, int numChannels)
+    : input(inputSource),
+      numberOfChannels(juce::jmax(1, numChannels))
+{
+    jassert(input != nullptr);
+}
+
+LoopingAudioSource::~LoopingAudioSource() {
+}
+
+void LoopingAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    headBuffer.setSize(numberOfChannels, headSize, false, true, false);
+    tailBuffer.setSize(numberOfChannels, maxCrossfadeLength, false, true, false);
+    headValid = 0;
+    tailValid = false;
+    playingFromHead = false;
+    fadePos = fadeLength;
+}
+
+void LoopingAudioSource::releaseResources() {
+    input->releaseResources();
+
+    headBuffer.setSize(0, 0);
+    tailBuffer.setSize(0, 0);
+    headValid = 0;
+    tailValid = false;
+    playingFromHead = false;
+}
+
+void LoopingAudioSource::setNextReadPosition(juce::int64 newPosition) {
+    newPosition = juce::jmax((juce::int64)0, newPosition);
+    input->setNextReadPosition(newPosition);
+    pendingSeek = newPosition;
+}
+
+juce::int64 LoopingAudioSource::getNextReadPosition() const {
+    const juce::int64 pending = pendingSeek.load();
+    return pending >= 0 ? pending : publishedPosition.load();
+}
+
+void LoopingAudioSource::setLoopRange(juce::int64 startSample, juce::int64 endSample) {
+    const juce::SpinLock::ScopedLockType sl(settingsLock);
+    requestedStart = startSample;
+    requestedEnd = endSample;
+}
+
+void LoopingAudioSource::setLoopEnabled(bool shouldLoop) {
+    requestedEnabled = shouldLoop;
+}
+
+void LoopingAudioSource::setCrossfadeLength(int numSamples) {
+    const juce::SpinLock::ScopedLockType sl(settingsLock);
+    requestedFade = juce::jlimit(0, maxCrossfadeLength, numSamples);
+}
+
+void LoopingAudioSource::syncLoopSettings() {
+    const juce::SpinLock::ScopedTryLockType sl(settingsLock);
+    if (!sl.isLocked())
+        return;
+
+    if (requestedStart != loopStart || requestedEnd != loopEnd) {
+        if (playingFromHead)
+            input->setNextReadPosition(position);
+        playingFromHead = false;
+        headValid = 0;
+        tailValid = false;
+        loopStart = requestedStart;
+        loopEnd = requestedEnd;
+    }
+
+    const bool hasRange = loopEnd > loopStart && loopStart >= 0;
+    const bool shouldLoop = requestedEnabled.load() && hasRange;
+
+    if (!shouldLoop && playingFromHead) {
+        input->setNextReadPosition(position);
+        playingFromHead = false;
+    }
+    loopActive = shouldLoop;
+
+    const int newFade = hasRange ? (int)juce::jmin((juce::int64)requestedFade, (loopEnd - loopStart) / 2) : 0;
+    if (newFade != fadeLength) {
+        tailValid = false;
+        fadeLength = newFade;
+        fadePos = fadeLength;
+    }
+}
+
+void LoopingAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    syncLoopSettings();
+
+    const juce::int64 pending = pendingSeek.exchange(-1);
+    if (pending >= 0) {
+        // the input was already repositioned by setNextReadPosition
+        position = pending;
+        playingFromHead = false;
+        fadePos = fadeLength;
+    }
+
+    auto& dest = *bufferToFill.buffer;
+    int done = 0;
+
+    while (done < bufferToFill.numSamples) {
+        if (loopActive && (position < loopStart || position >= loopEnd))
+            wrapToLoopStart(false);
+
+        int numThisTime = bufferToFill.numSamples - done;
+        if (loopActive)
+            numThisTime = (int)juce::jmin((juce::int64)numThisTime, loopEnd - position);
+
+        const int destStart = bufferToFill.startSample + done;
+        renderSegment(dest, destStart, numThisTime);
+
+        if (fadePos < fadeLength)
+            applySeamCrossfade(dest, destStart, numThisTime);
+
+        position += numThisTime;
+        done += numThisTime;
+
+        if (loopActive && position >= loopEnd) {
+            if (!playingFromHead)
+                captureTail();
+            wrapToLoopStart(true);
+        }
+    }
+
+    publishedPosition = position;
+}
+
+void LoopingAudioSource::wrapToLoopStart(bool crossfade) {
+    position = loopStart;
+    fadePos = (crossfade && tailValid) ? 0 : fadeLength;
+
+    const juce::int64 loopLength = loopEnd - loopStart;
+
+    if (headValid > 0) {
+        playingFromHead = true;
+        if (headValid < loopLength)
+            input->setNextReadPosition(loopStart + headValid);
+    }
+    else {
+        playingFromHead = false;
+        input->setNextReadPosition(loopStart);
+    }
+}
+
+void LoopingAudioSource::renderSegment(juce::AudioBuffer<float>& dest, int destStart, int numSamples) {
+    int rendered = 0;
+
+    if (playingFromHead) {
+        const int headOffset = (int)(position - loopStart);
+        const int fromHead = juce::jlimit(0, numSamples, headValid - headOffset);
+
+        if (fromHead > 0) {
+            for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+                dest.copyFrom(ch, destStart, headBuffer, juce::jmin(ch, numberOfChannels - 1), headOffset, fromHead);
+        }
+
+        rendered = fromHead;
+        if (fromHead < numSamples)
+            playingFromHead = false;
+    }
+
+    if (rendered < numSamples) {
+        juce::AudioSourceChannelInfo remaining(&dest, destStart + rendered, numSamples - rendered);
+        input->getNextAudioBlock(remaining);
+        captureHead(dest, destStart + rendered, position + rendered, numSamples - rendered);
+    }
+}
+
+void LoopingAudioSource::captureHead(const juce::AudioBuffer<float>& source, int sourceStart,
+    juce::int64 samplePos, int numSamples) {
+    if (loopEnd <= loopStart || headBuffer.getNumSamples() == 0)
+        return;
+
+    const juce::int64 captureFrom = loopStart + headValid;
+    const juce::int64 captureLimit = juce::jmin(loopStart + (juce::int64)headSize, loopEnd);
+
+    if (captureFrom >= captureLimit || samplePos > captureFrom || samplePos + numSamples <= captureFrom)
+        return;
+
+    if (!inputWasComplete()) {
+        // silence from a read-ahead miss must never end up in the loop
+        headValid = 0;
+        return;
+    }
+
+    const int offset = (int)(captureFrom - samplePos);
+    const int count = (int)juce::jmin((juce::int64)(numSamples - offset), captureLimit - captureFrom);
+
+    for (int ch = 0; ch < numberOfChannels; ++ch)
+        headBuffer.copyFrom(ch, headValid, source, juce::jmin(ch, source.getNumChannels() - 1), sourceStart + offset, count);
+
+    headValid += count;
+}
+
+void LoopingAudioSource::captureTail() {
+    if (tailValid || fadeLength <= 0)
+        return;
+
+    // the input sits exactly on loopEnd here, so this is what would have followed the seam
+    juce::AudioSourceChannelInfo tailInfo(&tailBuffer, 0, fadeLength);
+    input->getNextAudioBlock(tailInfo);
+    tailValid = inputWasComplete();
+}
+
+void LoopingAudioSource::applySeamCrossfade(juce::AudioBuffer<float>& dest, int destStart, int numSamples) {
+    const int count = juce::jmin(numSamples, fadeLength - fadePos);
+
+    for (int ch = 0; ch < dest.getNumChannels(); ++ch) {
+        auto* out = dest.getWritePointer(ch, destStart);
+        const auto* tail = tailBuffer.getReadPointer(juce::jmin(ch, numberOfChannels - 1), fadePos);
+
+        for (int i = 0; i < count; ++i) {
+            const float t = (float)(fadePos + i + 1) / (float)(fadeLength + 1);
+            const float angle = t * juce::MathConstants<float>::halfPi;
+            out[i] = out[i] * std::sin(angle) + tail[i] * std::cos(angle);
+        }
+    }
+
+    fadePos += count;
+}
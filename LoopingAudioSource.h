@@ -0,0 +1,72 @@
+#pragma once
+#include <JuceHeader.h>
+#include "ReadAheadAudioSource.h"
+
+// Wraps a PositionableAudioSource and loops a sample range inside getNextAudioBlock,
+// so the seam lands on the exact sample instead of on the next block boundary.
+// The first part of the loop is kept in RAM after the first pass, which lets the
+// wrap play instantly while the input catches up behind it.
+class LoopingAudioSource : public juce::PositionableAudioSource
+{
+public:
+    explicit LoopingAudioSource(juce::PositionableAudioSource* inputSource, int numChannels = 2);
+    ~LoopingAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override { return input->getTotalLength(); }
+    bool isLooping() const override { return requestedEnabled.load(); }
+
+    // message thread; picked up by the audio thread at the start of the next block
+    void setLoopRange(juce::int64 startSample, juce::int64 endSample);
+    void setLoopEnabled(bool shouldLoop);
+    void setCrossfadeLength(int numSamples);
+
+    // lets the head capture skip blocks the read-ahead could not fill in time
+    void setReadAheadSource(const ReadAheadAudioSource* source) { readAhead = source; }
+
+    static constexpr int headSize = 32768;
+    static constexpr int maxCrossfadeLength = 4096;
+
+private:
+    void syncLoopSettings();
+    void wrapToLoopStart(bool crossfade);
+    void renderSegment(juce::AudioBuffer<float>& dest, int destStart, int numSamples);
+    void captureHead(const juce::AudioBuffer<float>& source, int sourceStart, juce::int64 samplePos, int numSamples);
+    void captureTail();
+    void applySeamCrossfade(juce::AudioBuffer<float>& dest, int destStart, int numSamples);
+    bool inputWasComplete() const { return readAhead == nullptr || readAhead->wasLastBlockComplete(); }
+
+    juce::PositionableAudioSource* input;
+    const ReadAheadAudioSource* readAhead = nullptr;
+    int numberOfChannels;
+
+    juce::AudioBuffer<float> headBuffer;
+    juce::AudioBuffer<float> tailBuffer;
+    int headValid = 0;
+    bool tailValid = false;
+    bool playingFromHead = false;
+    int fadePos = 0;
+
+    // audio-thread copies of the loop settings
+    juce::int64 position = 0;
+    juce::int64 loopStart = 0;
+    juce::int64 loopEnd = 0;
+    bool loopActive = false;
+    int fadeLength = 0;
+
+    juce::SpinLock settingsLock;
+    juce::int64 requestedStart = 0;
+    juce::int64 requestedEnd = 0;
+    int requestedFade = 0;
+    std::atomic<bool> requestedEnabled{ false };
+
+    std::atomic<juce::int64> publishedPosition{ 0 };
+    std::atomic<juce::int64> pendingSeek{ -1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopingAudioSource)
+};
@@ -8,9 +8,16 @@ public:
     const juce::String getApplicationName() override { return "Simple Audio Player"; }
     const juce::String getApplicationVersion() override { return "1.0"; }
 
-    void initialise(const juce::String&) override
+    void initialise(const juce::String& commandLine) override
     {
-        mainWindow = std::make_unique<MainWindow>(getApplicationName());
+        // "--decks N" runs N players; the window shows the first two
+        int numDecks = 2;
+        auto args = juce::StringArray::fromTokens(commandLine, true);
+        const int flag = args.indexOf("--decks");
+        if (flag >= 0 && flag + 1 < args.size())
+            numDecks = args[flag + 1].getIntValue();
+
+        mainWindow = std::make_unique<MainWindow>(getApplicationName(), numDecks);
     }
 
     void shutdown() override
@@ -22,13 +29,13 @@ private:
     class MainWindow : public juce::DocumentWindow
     {
     public:
-        MainWindow(juce::String name)
+        MainWindow(juce::String name, int numDecks)
             : DocumentWindow(name,
                 juce::Colours::lightgrey,
                 DocumentWindow::allButtons)
         {
             setUsingNativeTitleBar(true);
-            setContentOwned(new MainComponent(), true);
+            setContentOwned(new MainComponent(numDecks), true);
             centreWithSize(1500, 650);
             setVisible(true);
         }
@@ -1,9 +1,29 @@
 #include "MainComponent.h"
 #include "PlayerGui.h"
 
-MainComponent::MainComponent()
+MainComponent::MainComponent(int numDecks)
 {
-    playerGui.setPlayerAudio(&playerAudioLeft, &playerAudioRight);
+    readAheadThread.startThread();
+
+    numDecks = juce::jlimit(minDecks, maxDecks, numDecks);
+    for (int i = 0; i < numDecks; ++i) {
+        auto* deck = decks.add(new PlayerAudio());
+        deck->setReadAheadThread(&readAheadThread);
+        deck->setLoaderPool(&loaderPool);
+        deck->setTrackCache(&trackCache);
+        deck->setMasterClock(&masterClock);
+        deckBuffers.add(new juce::AudioBuffer<float>());
+    }
+
+    renderPool = std::make_unique<DeckRenderPool>(DeckRenderPool::getDefaultNumWorkers(numDecks));
+    renderPool->setJob([this](int job) { renderDeck(activeDecks[(size_t)job]); });
+
+    playerGui.setPlayerAudio(decks[0], decks[1]);
+    playerGui.setCrossfader(&crossfader);
+    playerGui.onSyncPlay = [this]() { startDecksTogether({ 0, 1 }); };
+    playerGui.onLimiterToggled = [this](bool enabled) { setLimiterEnabled(enabled); };
+    // the decoded-track cache stays off until a size is picked in the GUI
+    playerGui.onTrackCacheBudgetChanged = [this](juce::int64 bytes) { trackCache.setMemoryBudget(bytes); };
     addAndMakeVisible(playerGui);
     setSize(1500, 650);
 
@@ -11,8 +31,10 @@ MainComponent::MainComponent()
     juce::File sessionFile = exeFile.getParentDirectory().getChildFile("session.txt");
 
     playerGui.loadSession(sessionFile);
+    loadRouting(getRoutingFile());
 
     setAudioChannels(0, 2);
+    openAllOutputs();
 }
 
 MainComponent::~MainComponent()
@@ -21,14 +43,36 @@ MainComponent::~MainComponent()
     juce::File sessionFile = exeFile.getParentDirectory().getChildFile("session.txt");
 
     playerGui.saveSession(sessionFile);
+    saveRouting(getRoutingFile());
 
     shutdownAudio();
+
+    readAheadThread.stopThread(2000);
 }
 
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    playerAudioLeft.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    playerAudioRight.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    masterClock.prepare(samplesPerBlockExpected, sampleRate);
+
+    for (auto* deck : decks)
+        deck->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    // scratch buffers are sized once here so the audio callback never allocates
+    for (auto* deckBuffer : deckBuffers)
+        deckBuffer->setSize(numMixChannels, samplesPerBlockExpected, false, true, false);
+    silentDeck.setSize(1, samplesPerBlockExpected, false, true, false);
+
+    // the device's layout is fixed until the next prepareToPlay, so the kernels are too
+    mixOutputs = getNumOutputChannels();
+    for (int n = 0; n <= maxDecks; ++n)
+        mixKernels[(size_t)n] = MixKernels::select(MixKernels::roundUpDecks(n), mixOutputs);
+
+    crossfader.prepareToPlay(sampleRate);
+
+    limiter.prepare(sampleRate, juce::jmax(numMixChannels, getNumOutputChannels()), samplesPerBlockExpected);
+    limiter.setCeilingDb(limiterCeilingDb);
+    limiterActive = limiterEnabled.load();
+    masterClock.setOutputLatency(limiterActive ? limiter.getLatencySamples() : 0);
 
     juce::MessageManager::callAsync([this]() {
         playerGui.restoreGUIFromSession();
@@ -37,35 +81,242 @@ void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    bufferToFill.buffer->clear();
+    bufferToFill.clearActiveBufferRegion();
+
+    const int scratchSize = deckBuffers.getFirst()->getNumSamples();
+    if (scratchSize <= 0)
+        return;
+
+    // the device may hand us more than samplesPerBlockExpected, so render in scratch-sized chunks
+    int done = 0;
+    while (done < bufferToFill.numSamples) {
+        const int chunk = juce::jmin(scratchSize, bufferToFill.numSamples - done);
+        const int outStart = bufferToFill.startSample + done;
+
+        numActiveDecks = 0;
+        for (int i = 0; i < decks.size(); ++i)
+            if (decks.getUnchecked(i)->needsRender())
+                activeDecks[(size_t)numActiveDecks++] = i;
+
+        // the crossfader sits between the first two decks; any others go straight to the mix
+        GainRamp::Block gainA, gainB;
+        crossfader.advance(chunk, gainA, gainB);
+
+        if (numActiveDecks > 0) {
+            // every active deck renders into its own buffer on the pool, then the mix runs here
+            renderChunkSize = chunk;
+            renderPool->run(numActiveDecks);
+
+            const MixKernels::Function kernel = mixKernels[(size_t)numActiveDecks];
+            if (kernel != nullptr && bufferToFill.buffer->getNumChannels() == mixOutputs) {
+                mixActiveDecks(kernel, *bufferToFill.buffer, outStart, gainA, gainB, chunk);
+            }
+            else {
+                for (int k = 0; k < numActiveDecks; ++k) {
+                    const int i = activeDecks[(size_t)k];
+                    const GainRamp::Block gain = i == 0 ? gainA : i == 1 ? gainB : GainRamp::Block();
+                    mixDeckInto(*bufferToFill.buffer, outStart, i, *deckBuffers.getUnchecked(i), gain, chunk);
+                }
+            }
+            silentSamples = 0;
+        }
+        else {
+            silentSamples = juce::jmin(silentSamples + chunk, 1 << 30);
+        }
+
+        masterClock.advance(chunk);
 
-    playerAudioLeft.getNextAudioBlock(bufferToFill);
+        done += chunk;
+    }
 
-    
-    if (bufferToFill.buffer->getNumChannels() >= 2) {
-      
-        auto tempBuffer = std::make_unique<juce::AudioBuffer<float>>(1, bufferToFill.numSamples);
-        tempBuffer->clear();
+    // switching starts from an empty delay line; the latency changes with it
+    const bool enabled = limiterEnabled.load();
+    if (enabled != limiterActive) {
+        limiter.reset();
+        limiterActive = enabled;
+        masterClock.setOutputLatency(limiterActive ? limiter.getLatencySamples() : 0);
+    }
 
-        juce::AudioSourceChannelInfo rightInfo;
-        rightInfo.buffer = tempBuffer.get();
-        rightInfo.startSample = 0;
-        rightInfo.numSamples = bufferToFill.numSamples;
+    // all decks stopped: the output stays cleared, and once the limiter's delay line has
+    // run empty it is reset and left out until a deck plays again
+    const bool flushed = silentSamples >= bufferToFill.numSamples + limiter.getLatencySamples();
+    if (flushed && limiterActive && !limiterIdle)
+        limiter.reset();
+    limiterIdle = flushed;
 
-        playerAudioRight.getNextAudioBlock(rightInfo);
+    if (limiterActive && !limiterIdle) {
+        float* channels[RoutingMatrix::maxOutputs];
+        const int numChannels = juce::jmin(bufferToFill.buffer->getNumChannels(), RoutingMatrix::maxOutputs);
+        for (int ch = 0; ch < numChannels; ++ch)
+            channels[ch] = bufferToFill.buffer->getWritePointer(ch, bufferToFill.startSample);
+        limiter.process(channels, numChannels, bufferToFill.numSamples);
+    }
+}
 
-        bufferToFill.buffer->copyFrom(1, bufferToFill.startSample,
-            *tempBuffer, 0, 0, bufferToFill.numSamples);
+void MainComponent::startDecksTogether(const juce::Array<int>& deckIndices, double delaySeconds)
+{
+    const juce::int64 startSample = masterClock.getSafeStartSample()
+        + (juce::int64)(juce::jmax(0.0, delaySeconds) * masterClock.getSampleRate());
+
+    for (int index : deckIndices)
+        if (auto* deck = decks[index])
+            deck->schedulePlay(startSample);
+}
+
+// runs on the audio thread or a render worker; touches only the deck and its own buffer
+void MainComponent::renderDeck(int deckIndex)
+{
+    juce::AudioSourceChannelInfo deckInfo(deckBuffers.getUnchecked(deckIndex), 0, renderChunkSize);
+    decks.getUnchecked(deckIndex)->getNextAudioBlock(deckInfo);
+}
+
+// The crossfader gain goes onto the deck's own buffer first, so every route the deck takes carries it.
+void MainComponent::mixDeckInto(juce::AudioBuffer<float>& output, int outputStart, int deckIndex,
+                                juce::AudioBuffer<float>& deckBuffer, const GainRamp::Block& gain, int numSamples)
+{
+    const int numOutputChannels = juce::jmin(output.getNumChannels(), RoutingMatrix::maxOutputs);
+
+    if (numOutputChannels == 1) {
+        // fold the stereo deck down for mono devices
+        float* dest = output.getWritePointer(0, outputStart);
+        GainRamp::add(gain, dest, deckBuffer.getReadPointer(0), numSamples, 0.5f);
+        GainRamp::add(gain, dest, deckBuffer.getReadPointer(1), numSamples, 0.5f);
+        return;
     }
 
-    
-    playerAudioLeft.performLoop();
-    playerAudioRight.performLoop();
+    for (int ch = 0; ch < numMixChannels; ++ch)
+        GainRamp::apply(gain, deckBuffer.getWritePointer(ch), numSamples);
+
+    float* outputs[RoutingMatrix::maxOutputs];
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+        outputs[ch] = output.getWritePointer(ch, outputStart);
+
+    routing.mixDeck(deckIndex, deckBuffer.getArrayOfReadPointers(), numMixChannels, outputs, numOutputChannels, numSamples);
 }
+
+// Same result as mixDeckInto() for every active deck, but each output sample is written once.
+// Slots beyond the active decks mix silence at no gain.
+void MainComponent::mixActiveDecks(MixKernels::Function kernel, juce::AudioBuffer<float>& output, int outputStart,
+                                   const GainRamp::Block& gainA, const GainRamp::Block& gainB, int numSamples)
+{
+    constexpr int perDeck = MixKernels::channelsPerDeck;
+    const int kernelDecks = MixKernels::roundUpDecks(numActiveDecks);
+    const int numInputs = kernelDecks * perDeck;
+
+    const float* inputs[MixKernels::maxDecks * perDeck];
+    for (int k = 0; k < kernelDecks; ++k) {
+        if (k >= numActiveDecks) {
+            for (int ch = 0; ch < perDeck; ++ch) {
+                inputs[k * perDeck + ch] = silentDeck.getReadPointer(0);
+                for (int out = 0; out < mixOutputs; ++out)
+                    mixGains[(size_t)(out * numInputs + k * perDeck + ch)] = MixKernels::Gain();
+            }
+            continue;
+        }
+
+        const int i = activeDecks[(size_t)k];
+        auto& deckBuffer = *deckBuffers.getUnchecked(i);
+        const GainRamp::Block gain = i == 0 ? gainA : i == 1 ? gainB : GainRamp::Block();
+        for (int ch = 0; ch < perDeck; ++ch) {
+            GainRamp::apply(gain, deckBuffer.getWritePointer(ch), numSamples);
+            inputs[k * perDeck + ch] = deckBuffer.getReadPointer(ch);
+        }
+
+        if (mixOutputs == 1) {
+            // fold the stereo deck down for mono devices
+            mixGains[(size_t)(k * perDeck)] = MixKernels::Gain{ 0.5f, 0.0f };
+            mixGains[(size_t)(k * perDeck + 1)] = MixKernels::Gain{ 0.5f, 0.0f };
+        }
+        else {
+            routing.advanceDeck(i, mixOutputs, numSamples, mixGains.data() + k * perDeck, numInputs);
+        }
+    }
+
+    float* outputs[MixKernels::maxOutputs];
+    for (int out = 0; out < mixOutputs; ++out)
+        outputs[out] = output.getWritePointer(out, outputStart);
+
+    kernel(inputs, mixGains.data(), outputs, numSamples);
+}
+
+int MainComponent::getNumOutputChannels() const
+{
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        return juce::jmin(device->getActiveOutputChannels().countNumberOfSetBits(), RoutingMatrix::maxOutputs);
+    return numMixChannels;
+}
+
+void MainComponent::openAllOutputs()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr)
+        return;
+
+    const int available = juce::jmin(device->getOutputChannelNames().size(), RoutingMatrix::maxOutputs);
+    auto setup = deviceManager.getAudioDeviceSetup();
+    if (available <= setup.outputChannels.countNumberOfSetBits())
+        return;
+
+    setup.outputChannels.clear();
+    setup.outputChannels.setRange(0, available, true);
+    setup.useDefaultOutputChannels = false;
+    deviceManager.setAudioDeviceSetup(setup, true);
+}
+
+juce::File MainComponent::getRoutingFile()
+{
+    juce::File exeFile = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
+    return exeFile.getParentDirectory().getChildFile("routing.txt");
+}
+
+// One route per line, "deck channel output gain", all numbered from 1; '#' starts a comment.
+// Without the file every deck plays on outputs 1 and 2.
+void MainComponent::loadRouting(const juce::File& file)
+{
+    if (!file.existsAsFile())
+        return;
+
+    juce::StringArray lines;
+    file.readLines(lines);
+
+    routing.clear();
+    for (auto line : lines) {
+        line = line.upToFirstOccurrenceOf("#", false, false).trim();
+        if (line.isEmpty())
+            continue;
+
+        juce::StringArray fields;
+        fields.addTokens(line, " \t", "");
+        fields.removeEmptyStrings();
+        if (fields.size() < 4)
+            continue;
+
+        routing.setGain(fields[0].getIntValue() - 1, fields[1].getIntValue() - 1,
+                        fields[2].getIntValue() - 1, fields[3].getFloatValue());
+    }
+}
+
+void MainComponent::saveRouting(const juce::File& file) const
+{
+    juce::String text = "# deck channel output gain\n";
+    for (int deck = 0; deck < decks.size(); ++deck)
+        for (int ch = 0; ch < RoutingMatrix::maxDeckChannels; ++ch)
+            for (int out = 0; out < RoutingMatrix::maxOutputs; ++out) {
+                const float gain = routing.getGain(deck, ch, out);
+                if (gain > 0.0f)
+                    text << (deck + 1) << " " << (ch + 1) << " " << (out + 1) << " " << gain << "\n";
+            }
+
+    file.replaceWithText(text);
+}
+
 void MainComponent::releaseResources()
 {
-    playerAudioLeft.releaseResources();
-    playerAudioRight.releaseResources();
+    for (auto* deck : decks)
+        deck->releaseResources();
+
+    for (auto* deckBuffer : deckBuffers)
+        deckBuffer->setSize(0, 0);
 }
 
 
@@ -2,13 +2,23 @@
 
 #include <JuceHeader.h>
 #include "PlayerGui.h"  
+#include "DeckRenderPool.h"
+#include "Crossfader.h"
+#include "MasterClock.h"
+#include "TruePeakLimiter.h"
+#include "RoutingMatrix.h"
+#include "MixKernels.h"
 
 
 class MainComponent : public juce::AudioAppComponent
 
 {
 public:
-    MainComponent();
+    static constexpr int minDecks = 2;
+    static constexpr int maxDecks = 16;
+
+    // numDecks is clamped to [minDecks, maxDecks]; the GUI drives the first two
+    explicit MainComponent(int numDecks = minDecks);
     ~MainComponent() override;
 
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
@@ -20,12 +30,79 @@ public:
         playerGui.setBounds(getLocalBounds());
     }
 
+    int getNumDecks() const { return decks.size(); }
+    PlayerAudio* getDeck(int index) const { return decks[index]; }
+
+    const MasterClock& getMasterClock() const { return masterClock; }
+
+    // true-peak limiter on the master bus, on by default; adds its lookahead to the output latency
+    void setLimiterEnabled(bool shouldBeEnabled) { limiterEnabled = shouldBeEnabled; }
+    bool isLimiterEnabled() const { return limiterEnabled.load(); }
+    int getOutputLatencySamples() const { return masterClock.getOutputLatency(); }
+
+    // starts the given decks on the same output sample, delaySeconds from now at the earliest
+    void startDecksTogether(const juce::Array<int>& deckIndices, double delaySeconds = 0.0);
+
+    // which device outputs each deck channel feeds, and at what gain; takes effect on the next block
+    RoutingMatrix& getRouting() { return routing; }
+    // active outputs on the open device, up to RoutingMatrix::maxOutputs
+    int getNumOutputChannels() const;
+
 
 private:
 
-    PlayerAudio playerAudioLeft;
-    PlayerAudio playerAudioRight;
+    void renderDeck(int deckIndex);
+    void mixDeckInto(juce::AudioBuffer<float>& output, int outputStart, int deckIndex,
+                     juce::AudioBuffer<float>& deckBuffer, const GainRamp::Block& gain, int numSamples);
+    void mixActiveDecks(MixKernels::Function kernel, juce::AudioBuffer<float>& output, int outputStart,
+                        const GainRamp::Block& gainA, const GainRamp::Block& gainB, int numSamples);
+
+    // asks the device for every output it has once it is open, rather than just the first two
+    void openAllOutputs();
+    static juce::File getRoutingFile();
+    void loadRouting(const juce::File& file);
+    void saveRouting(const juce::File& file) const;
+
+    static constexpr int numMixChannels = 2;
+
+    // shared by every deck for disk reads and decoding; declared first so it outlives them
+    juce::TimeSliceThread readAheadThread{ "Deck read-ahead" };
+    juce::ThreadPool loaderPool{ 1 };
+    DecodedTrackCache trackCache;
+
+    MasterClock masterClock;
+    juce::OwnedArray<PlayerAudio> decks;
+    Crossfader crossfader;
+    RoutingMatrix routing{ maxDecks };
+
+    static constexpr float limiterCeilingDb = -1.0f;
+    TruePeakLimiter limiter;
+    std::atomic<bool> limiterEnabled{ true };
+    bool limiterActive = false;
     PlayerGui playerGui;
 
+    // per-deck stereo render targets, allocated in prepareToPlay; each deck writes only its own
+    juce::OwnedArray<juce::AudioBuffer<float>> deckBuffers;
+    int renderChunkSize = 0;
+
+    // decks with anything to do in the current chunk; stopped decks are not rendered or mixed
+    std::array<int, maxDecks> activeDecks{};
+    int numActiveDecks = 0;
+
+    // the fused mix for the device's outputs, by number of active decks, chosen in
+    // prepareToPlay(); nullptr where there is no specialisation and mixDeckInto() runs instead
+    std::array<MixKernels::Function, maxDecks + 1> mixKernels{};
+    int mixOutputs = 0;
+    std::array<MixKernels::Gain, MixKernels::maxOutputs * MixKernels::maxDecks * MixKernels::channelsPerDeck> mixGains{};
+    // stands in for the decks a kernel has room for beyond the active ones
+    juce::AudioBuffer<float> silentDeck;
+
+    // output samples since a deck last rendered; once the limiter has flushed, it is skipped too
+    int silentSamples = 0;
+    bool limiterIdle = false;
+
+    // renders the decks in parallel each block; stopped before the decks go away
+    std::unique_ptr<DeckRenderPool> renderPool;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
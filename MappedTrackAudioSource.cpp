@@ -0,0 +1,151 @@
+#include "MappedTrackAudioSource.h"
+
+MappedTrackAudioSource::MappedTrackAudioSource(std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader,
+    juce::TimeSliceThread* prefetchThread)
+    : reader(std::move(mappedReader)),
+      thread(prefetchThread)
+{
+    jassert(reader != nullptr);
+
+    bytesPerFrame = juce::jmax(1, (int)(reader->numChannels * reader->bitsPerSample / 8));
+    samplesPerPage = juce::jmax(1, 4096 / bytesPerFrame);
+}
+
+MappedTrackAudioSource::~MappedTrackAudioSource() {
+    releaseResources();
+}
+
+std::unique_ptr<MappedTrackAudioSource> MappedTrackAudioSource::createFor(juce::AudioFormatManager& formatManager,
+    const juce::File& file, juce::TimeSliceThread* prefetchThread)
+{
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+    if (format == nullptr)
+        return nullptr;
+
+    // only the uncompressed formats implement this; everything else returns nullptr
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+    if (mapped == nullptr || mapped->lengthInSamples <= 0)
+        return nullptr;
+
+    auto source = std::make_unique<MappedTrackAudioSource>(std::move(mapped), prefetchThread);
+    if (!source->mapPcmData(file) && !source->reader->mapEntireFile())
+        return nullptr;
+
+    return source;
+}
+
+// Offset of the first sample in a RIFF/RF64 WAVE file, or 0 if the layout is not understood.
+static size_t findWavDataOffset(const juce::uint8* data, size_t size) {
+    if (size < 12 || (std::memcmp(data, "RIFF", 4) != 0 && std::memcmp(data, "RF64", 4) != 0)
+        || std::memcmp(data + 8, "WAVE", 4) != 0)
+        return 0;
+
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        if (std::memcmp(data + pos, "data", 4) == 0)
+            return pos + 8;
+
+        const juce::uint32 chunkSize = juce::ByteOrder::littleEndianInt(data + pos + 4);
+        pos += 8 + (size_t)chunkSize + (chunkSize & 1);
+    }
+    return 0;
+}
+
+// Maps the file ourselves when it is integer PCM WAV, so the deck can convert it with
+// the SIMD kernels. AIFF is big-endian and float WAV needs no conversion; both stay on
+// the reader.
+bool MappedTrackAudioSource::mapPcmData(const juce::File& file) {
+    if (reader->usesFloatingPointData || !file.hasFileExtension(".wav;.bwf"))
+        return false;
+
+    switch (reader->bitsPerSample) {
+    case 16: pcmFormat = PcmConvert::Format::Int16; break;
+    case 24: pcmFormat = PcmConvert::Format::Int24; break;
+    case 32: pcmFormat = PcmConvert::Format::Int32; break;
+    default: return false;
+    }
+
+    auto map = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    const auto* data = static_cast<const juce::uint8*>(map->getData());
+    if (data == nullptr)
+        return false;
+
+    const size_t offset = findWavDataOffset(data, map->getSize());
+    const juce::int64 dataBytes = reader->lengthInSamples * bytesPerFrame;
+    if (offset == 0 || (juce::int64)offset + dataBytes > (juce::int64)map->getSize())
+        return false;
+
+    pcmFile = std::move(map);
+    pcmData = data + offset;
+    return true;
+}
+
+void MappedTrackAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    (void)samplesPerBlockExpected;
+    (void)sampleRate;
+
+    if (thread != nullptr) {
+        thread->removeTimeSliceClient(this);
+        touchedFrom = touchedTo = position.load();
+        thread->addTimeSliceClient(this);
+    }
+}
+
+void MappedTrackAudioSource::releaseResources() {
+    if (thread != nullptr)
+        thread->removeTimeSliceClient(this);
+}
+
+void MappedTrackAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    const juce::int64 start = position.load();
+    const juce::int64 available = juce::jmax((juce::int64)0, reader->lengthInSamples - start);
+    const int num = (int)juce::jmin((juce::int64)bufferToFill.numSamples, available);
+
+    if (num > 0 && pcmData != nullptr) {
+        float* dest[8];
+        const int numDest = juce::jmin(8, bufferToFill.buffer->getNumChannels());
+        for (int ch = 0; ch < numDest; ++ch)
+            dest[ch] = bufferToFill.buffer->getWritePointer(ch, bufferToFill.startSample);
+
+        PcmConvert::interleavedToFloat(pcmFormat, pcmData + start * bytesPerFrame, (int)reader->numChannels,
+            dest, numDest, num);
+    }
+    else if (num > 0) {
+        reader->read(bufferToFill.buffer, bufferToFill.startSample, num, start, true, true);
+    }
+    if (num < bufferToFill.numSamples)
+        bufferToFill.buffer->clear(bufferToFill.startSample + num, bufferToFill.numSamples - num);
+
+    position = start + bufferToFill.numSamples;
+}
+
+void MappedTrackAudioSource::touch(juce::int64 sample) const {
+    if (pcmData != nullptr) {
+        const volatile juce::uint8* p = pcmData + sample * bytesPerFrame;
+        (void)*p;
+    }
+    else {
+        reader->touchSample(sample);
+    }
+}
+
+// Walks one sample per page from the play position up to prefetchSeconds ahead of it.
+int MappedTrackAudioSource::useTimeSlice() {
+    const juce::int64 pos = position.load();
+    const juce::int64 length = reader->lengthInSamples;
+    const juce::int64 target = juce::jmin(length, pos + (juce::int64)(prefetchSeconds * reader->sampleRate));
+
+    // jumped outside what has been touched: start again from the new position
+    if (pos < touchedFrom || pos > touchedTo)
+        touchedFrom = touchedTo = pos;
+
+    if (touchedTo >= target)
+        return 20;
+
+    const juce::int64 sliceEnd = juce::jmin(target, touchedTo + (juce::int64)samplesPerPage * 256);
+    for (juce::int64 s = touchedTo; s < sliceEnd; s += samplesPerPage)
+        touch(s);
+
+    touchedTo = sliceEnd;
+    return 1;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PcmConvert.h"
+
+// Plays an uncompressed file (WAV/AIFF) straight out of a memory mapping, so samples are
+// converted from the page cache into the output with no intermediate buffer and a seek
+// is just a new read position. Integer PCM WAV goes through the SIMD PcmConvert kernels;
+// everything else uses the format's own MemoryMappedAudioFormatReader. A TimeSliceClient touches the pages ahead of the play
+// position so the audio thread does not take the page faults itself.
+class MappedTrackAudioSource : public juce::PositionableAudioSource,
+    private juce::TimeSliceClient
+{
+public:
+    MappedTrackAudioSource(std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader,
+        juce::TimeSliceThread* prefetchThread);
+    ~MappedTrackAudioSource() override;
+
+    // maps the whole file; nullptr if the format has no mapped reader or the mapping fails
+    static std::unique_ptr<MappedTrackAudioSource> createFor(juce::AudioFormatManager& formatManager,
+        const juce::File& file, juce::TimeSliceThread* prefetchThread);
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override { position = juce::jmax((juce::int64)0, newPosition); }
+    juce::int64 getNextReadPosition() const override { return position.load(); }
+    juce::int64 getTotalLength() const override { return reader->lengthInSamples; }
+    bool isLooping() const override { return false; }
+
+    double getSampleRate() const { return reader->sampleRate; }
+    int getNumChannels() const { return (int)reader->numChannels; }
+
+    static constexpr double prefetchSeconds = 4.0;
+
+private:
+    int useTimeSlice() override;
+    void touch(juce::int64 sample) const;
+    bool mapPcmData(const juce::File& file);
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+
+    // set when the samples are little-endian integer PCM that PcmConvert can read in place
+    std::unique_ptr<juce::MemoryMappedFile> pcmFile;
+    const juce::uint8* pcmData = nullptr;
+    PcmConvert::Format pcmFormat = PcmConvert::Format::Int16;
+    int bytesPerFrame = 0;
+    juce::TimeSliceThread* thread;
+    std::atomic<juce::int64> position{ 0 };
+
+    // prefetch thread only
+    juce::int64 touchedFrom = 0;
+    juce::int64 touchedTo = 0;
+    int samplesPerPage = 1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MappedTrackAudioSource)
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Counts output samples since the audio device first started. MainComponent advances it
+// after each mixed block; decks read it at the start of their render to place scheduled
+// commands on an exact sample, so several decks can act on the same one.
+class MasterClock
+{
+public:
+    juce::int64 getSamplePosition() const { return samplePosition.load(); }
+    double getSampleRate() const { return sampleRate.load(); }
+
+    // samples between the mix and the device, e.g. a limiter's lookahead
+    int getOutputLatency() const { return outputLatency.load(); }
+    juce::int64 getAudibleSamplePosition() const { return samplePosition.load() - outputLatency.load(); }
+
+    // a few blocks ahead, so a command posted now still reaches the deck before its sample
+    juce::int64 getSafeStartSample() const {
+        return samplePosition.load() + 4 * (juce::int64)blockSize.load();
+    }
+
+    // audio thread
+    void prepare(int samplesPerBlockExpected, double newSampleRate) {
+        blockSize = samplesPerBlockExpected;
+        sampleRate = newSampleRate;
+    }
+
+    void setOutputLatency(int numSamples) {
+        outputLatency = numSamples;
+    }
+
+    void advance(int numSamples) {
+        samplePosition.fetch_add(numSamples);
+    }
+
+private:
+    std::atomic<juce::int64> samplePosition{ 0 };
+    std::atomic<double> sampleRate{ 0.0 };
+    std::atomic<int> blockSize{ 0 };
+    std::atomic<int> outputLatency{ 0 };
+};
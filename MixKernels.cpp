@@ -0,0 +1,160 @@
+#include "MixKernels.h"
+#include "SimdSupport.h"
+#include <cstring>
+
+namespace
+{
+    using MixKernels::Gain;
+
+    // The gain for sample i is start + i * step in every kernel, and the inputs are summed
+    // in the order they come in, so every instruction set gives the same output bit for bit.
+    // Routes with no gain are left out before the kernels run, as the per-deck mix skips them.
+
+    struct Scalar
+    {
+        template <int NumInputs, bool Ramp>
+        static void mix(const float* const* inputs, const Gain* gains, float* out, int begin, int numSamples) {
+            for (int i = begin; i < numSamples; ++i) {
+                float sum = 0.0f;
+                for (int k = 0; k < NumInputs; ++k)
+                    sum += inputs[k][i] * (Ramp ? gains[k].start + (float)i * gains[k].step : gains[k].start);
+                out[i] = sum;
+            }
+        }
+
+        template <int NumInputs, bool Ramp>
+        static void mix(const float* const* inputs, const Gain* gains, float* out, int numSamples) {
+            mix<NumInputs, Ramp>(inputs, gains, out, 0, numSamples);
+        }
+    };
+
+#if SIMDSUPPORT_X86
+    struct Sse2
+    {
+        template <int NumInputs, bool Ramp>
+        static void mix(const float* const* inputs, const Gain* gains, float* out, int numSamples) {
+            __m128 start[NumInputs];
+            __m128 step[NumInputs];
+            for (int k = 0; k < NumInputs; ++k) {
+                start[k] = _mm_set1_ps(gains[k].start);
+                step[k] = _mm_set1_ps(gains[k].step);
+            }
+
+            const __m128 four = _mm_set1_ps(4.0f);
+            __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4) {
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < NumInputs; ++k) {
+                    const __m128 gain = Ramp ? _mm_add_ps(start[k], _mm_mul_ps(index, step[k])) : start[k];
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(inputs[k] + i), gain));
+                }
+                _mm_storeu_ps(out + i, sum);
+                if (Ramp)
+                    index = _mm_add_ps(index, four);
+            }
+            Scalar::mix<NumInputs, Ramp>(inputs, gains, out, i, numSamples);
+        }
+    };
+
+    struct Avx2
+    {
+        template <int NumInputs, bool Ramp>
+        SIMDSUPPORT_AVX2 static void mix(const float* const* inputs, const Gain* gains, float* out, int numSamples) {
+            __m256 start[NumInputs];
+            __m256 step[NumInputs];
+            for (int k = 0; k < NumInputs; ++k) {
+                start[k] = _mm256_set1_ps(gains[k].start);
+                step[k] = _mm256_set1_ps(gains[k].step);
+            }
+
+            const __m256 eight = _mm256_set1_ps(8.0f);
+            __m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8) {
+                __m256 sum = _mm256_setzero_ps();
+                for (int k = 0; k < NumInputs; ++k) {
+                    const __m256 gain = Ramp ? _mm256_add_ps(start[k], _mm256_mul_ps(index, step[k])) : start[k];
+                    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(inputs[k] + i), gain));
+                }
+                _mm256_storeu_ps(out + i, sum);
+                if (Ramp)
+                    index = _mm256_add_ps(index, eight);
+            }
+            Scalar::mix<NumInputs, Ramp>(inputs, gains, out, i, numSamples);
+        }
+    };
+#endif
+
+    // picks the kernel unrolled for exactly count inputs, count <= MaxInputs; no inputs is silence
+    template <typename Isa, int MaxInputs, bool Ramp>
+    void mixRoutes(int count, const float* const* inputs, const Gain* gains, float* out, int numSamples) {
+        if constexpr (MaxInputs == 0)
+            std::memset(out, 0, sizeof(float) * (size_t)numSamples);
+        else if (count == MaxInputs)
+            Isa::template mix<MaxInputs, Ramp>(inputs, gains, out, numSamples);
+        else
+            mixRoutes<Isa, MaxInputs - 1, Ramp>(count, inputs, gains, out, numSamples);
+    }
+
+    template <typename Isa, int NumDecks, int NumOutputs>
+    void mixLayout(const float* const* inputs, const Gain* gains, float* const* outputs, int numSamples) {
+        constexpr int numInputs = NumDecks * MixKernels::channelsPerDeck;
+
+        for (int o = 0; o < NumOutputs; ++o) {
+            const Gain* row = gains + o * numInputs;
+
+            const float* routed[numInputs];
+            Gain routedGains[numInputs];
+            int count = 0;
+            bool ramp = false;
+            for (int k = 0; k < numInputs; ++k) {
+                if (row[k].start == 0.0f && row[k].step == 0.0f)
+                    continue;
+                routed[count] = inputs[k];
+                routedGains[count++] = row[k];
+                ramp = ramp || row[k].step != 0.0f;
+            }
+
+            if (ramp)
+                mixRoutes<Isa, numInputs, true>(count, routed, routedGains, outputs[o], numSamples);
+            else
+                mixRoutes<Isa, numInputs, false>(count, routed, routedGains, outputs[o], numSamples);
+        }
+    }
+
+    template <int NumDecks, int NumOutputs>
+    MixKernels::Function pick() {
+       #if SIMDSUPPORT_X86
+        return SimdSupport::hasAvx2() ? mixLayout<Avx2, NumDecks, NumOutputs> : mixLayout<Sse2, NumDecks, NumOutputs>;
+       #else
+        return mixLayout<Scalar, NumDecks, NumOutputs>;
+       #endif
+    }
+
+    template <int NumDecks>
+    MixKernels::Function pickForOutputs(int numOutputs) {
+        switch (numOutputs) {
+        case 1: return pick<NumDecks, 1>();
+        case 2: return pick<NumDecks, 2>();
+        case 6: return pick<NumDecks, 6>();
+        default: return nullptr;
+        }
+    }
+}
+
+int MixKernels::roundUpDecks(int numDecks) {
+    if (numDecks <= 2) return 2;
+    if (numDecks <= 4) return 4;
+    if (numDecks <= maxDecks) return maxDecks;
+    return 0;
+}
+
+MixKernels::Function MixKernels::select(int numDecks, int numOutputs) {
+    switch (numDecks) {
+    case 2: return pickForOutputs<2>(numOutputs);
+    case 4: return pickForOutputs<4>(numOutputs);
+    case 8: return pickForOutputs<8>(numOutputs);
+    default: return nullptr;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Mixes every channel of several decks into every device output in one pass: each output
+// sample is the sum of the deck channels routed to it times their gains, written once, so
+// the output needs no clearing and is not read back per deck. Specialised at compile time
+// for mono, stereo and 5.1 outputs and for 2, 4 and 8 decks. Once per block and output the
+// routes with a gain are gathered and handed to a kernel unrolled for exactly that many,
+// so the per-sample path has no branches; SSE2 or AVX2 is picked along with the layout.
+// Free of JUCE so the benchmark can build it on its own.
+namespace MixKernels
+{
+    // decks render stereo
+    constexpr int channelsPerDeck = 2;
+    // the largest specialised layout
+    constexpr int maxDecks = 8;
+    constexpr int maxOutputs = 6;
+
+    // a route's gain over the block: start + i * step for sample i
+    struct Gain {
+        float start = 0.0f;
+        float step = 0.0f;
+    };
+
+    // inputs holds numDecks * channelsPerDeck channels, deck by deck; gains holds one row of
+    // as many entries per output, in the same order. outputs are overwritten.
+    using Function = void (*)(const float* const* inputs, const Gain* gains, float* const* outputs, int numSamples);
+
+    // the smallest specialised deck count that holds numDecks, or 0 if there is none
+    int roundUpDecks(int numDecks);
+
+    // nullptr for a layout without a specialisation
+    Function select(int numDecks, int numOutputs);
+}
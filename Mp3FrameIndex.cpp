@@ -0,0 +1,425 @@
+#include "Mp3FrameIndex.h"
+#include <cstring>
+
+namespace
+{
+    constexpr int sidecarMagic = 0x4933504d; // "MP3I"
+    constexpr int sidecarVersion = 1;
+
+    // frames the decoder runs through before a seek target, and the Layer III bit reservoir
+    // they have to cover: a frame may take up to 511 bytes of its data from earlier ones
+    constexpr int minPrimingFrames = 2;
+    constexpr int maxReservoirBytes = 511;
+
+    struct FrameHeader {
+        int version = 0; // 3 MPEG-1, 2 MPEG-2, 0 MPEG-2.5
+        int layer = 0;
+        int sampleRate = 0;
+        int numChannels = 0;
+        int frameBytes = 0;
+        int samplesPerFrame = 0;
+
+        bool sameStreamAs(const FrameHeader& other) const {
+            return version == other.version && layer == other.layer && sampleRate == other.sampleRate;
+        }
+    };
+
+    // free-format streams (no bitrate in the header) are left to the decoder
+    bool parseHeader(const juce::uint8* h, FrameHeader& header) {
+        static const short bitrates[2][3][15] = {
+            { { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+              { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+              { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 } },
+            { { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+              { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+              { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 } } };
+        static const int sampleRates[3] = { 44100, 48000, 32000 };
+
+        if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0)
+            return false;
+
+        const int version = (h[1] >> 3) & 3;
+        const int layerBits = (h[1] >> 1) & 3;
+        const int bitrateIndex = h[2] >> 4;
+        const int rateIndex = (h[2] >> 2) & 3;
+        if (version == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3)
+            return false;
+
+        header.version = version;
+        header.layer = 4 - layerBits;
+        header.sampleRate = sampleRates[rateIndex] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+        header.numChannels = (h[3] >> 6) == 3 ? 1 : 2;
+
+        const int bitrate = bitrates[version == 3 ? 0 : 1][header.layer - 1][bitrateIndex] * 1000;
+        const int padding = (h[2] >> 1) & 1;
+
+        if (header.layer == 1) {
+            header.frameBytes = (12 * bitrate / header.sampleRate + padding) * 4;
+            header.samplesPerFrame = 384;
+        }
+        else {
+            const bool half = header.layer == 3 && version != 3;
+            header.frameBytes = (half ? 72 : 144) * bitrate / header.sampleRate + padding;
+            header.samplesPerFrame = half ? 576 : 1152;
+        }
+        return true;
+    }
+
+    juce::uint32 readBigEndian(const juce::uint8* p) {
+        return ((juce::uint32)p[0] << 24) | ((juce::uint32)p[1] << 16) | ((juce::uint32)p[2] << 8) | p[3];
+    }
+
+    // the frame count from a Xing/Info or VBRI header in this frame, 0 if the header leaves
+    // it out, -1 if the frame has no such header
+    juce::int64 readTagFrameCount(const juce::uint8* frame, juce::int64 available, const FrameHeader& header) {
+        const int sideInfo = header.version == 3 ? (header.numChannels == 1 ? 17 : 32)
+                                                 : (header.numChannels == 1 ? 9 : 17);
+        const juce::int64 xing = 4 + sideInfo;
+        if (xing + 12 <= available
+            && (std::memcmp(frame + xing, "Xing", 4) == 0 || std::memcmp(frame + xing, "Info", 4) == 0)) {
+            const juce::uint32 flags = readBigEndian(frame + xing + 4);
+            return (flags & 1) != 0 ? (juce::int64)readBigEndian(frame + xing + 8) : 0;
+        }
+
+        const juce::int64 vbri = 4 + 32;
+        if (vbri + 18 <= available && std::memcmp(frame + vbri, "VBRI", 4) == 0)
+            return (juce::int64)readBigEndian(frame + vbri + 14);
+
+        return -1;
+    }
+
+    juce::int64 skipId3v2(const juce::uint8* data, juce::int64 size) {
+        if (size < 10 || std::memcmp(data, "ID3", 3) != 0)
+            return 0;
+        const juce::int64 tagSize = ((juce::int64)(data[6] & 0x7f) << 21) | ((data[7] & 0x7f) << 14)
+                                  | ((data[8] & 0x7f) << 7) | (data[9] & 0x7f);
+        return 10 + tagSize + ((data[5] & 0x10) != 0 ? 10 : 0);
+    }
+
+    // the first frame at or after pos that is followed by another frame of the same stream,
+    // so a stray sync pattern in a tag or in junk is not taken for audio; -1 if none
+    juce::int64 findFrame(const juce::uint8* data, juce::int64 size, juce::int64 pos, FrameHeader& header) {
+        for (; pos + 4 <= size; ++pos) {
+            if (!parseHeader(data + pos, header))
+                continue;
+
+            const juce::int64 next = pos + header.frameBytes;
+            FrameHeader following;
+            if (next + 4 > size || (parseHeader(data + next, following) && following.sameStreamAs(header)))
+                return pos;
+        }
+        return -1;
+    }
+}
+
+#if JUCE_USE_MP3AUDIOFORMAT
+// Reads through the format's own decoder, opened on the part of the file that starts a few
+// frames before the wanted sample. Sequential reads carry on with the same decoder; any
+// other position opens a new one there, so a seek costs a few frames wherever it lands.
+class IndexedMp3Reader : public juce::AudioFormatReader
+{
+public:
+    IndexedMp3Reader(const juce::File& f, std::shared_ptr<const Mp3FrameIndex> i)
+        : juce::AudioFormatReader(nullptr, "MP3 file"), file(f), index(std::move(i)) {
+        sampleRate = index->getSampleRate();
+        numChannels = (unsigned int)index->getNumChannels();
+        lengthInSamples = index->getLengthInSamples();
+        bitsPerSample = 32;
+        usesFloatingPointData = true;
+        skipBuffer.allocate((size_t)(skipLength * 2), true);
+    }
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+        juce::int64 startSampleInFile, int numSamples) override {
+        if (decoder == nullptr || startSampleInFile != decoderPosition)
+            openAt(startSampleInFile);
+
+        if (decoder == nullptr) {
+            for (int ch = 0; ch < numDestChannels; ++ch)
+                if (destChannels[ch] != nullptr)
+                    juce::zeromem(destChannels[ch] + startOffsetInDestBuffer, sizeof(int) * (size_t)numSamples);
+            return false;
+        }
+
+        const bool ok = decoder->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer,
+            decoderPosition - decoderStart, numSamples);
+        decoderPosition += numSamples;
+        return ok;
+    }
+
+private:
+    void openAt(juce::int64 sample) {
+        decoder.reset();
+
+        const int spf = index->getSamplesPerFrame();
+        const int target = (int)juce::jlimit((juce::int64)0, (juce::int64)index->getNumFrames() - 1, sample / spf);
+
+        // the frame before the target has to decode cleanly too, since the target overlaps it
+        int first = target;
+        while (first > 0 && (target - first < minPrimingFrames
+            || index->getFrameOffset(target - 1) - index->getFrameOffset(first) < maxReservoirBytes))
+            --first;
+
+        auto stream = std::make_unique<juce::FileInputStream>(file);
+        if (stream->failedToOpen())
+            return;
+
+        decoder.reset(format.createReaderFor(new juce::SubregionStream(stream.release(),
+            index->getFrameOffset(first), -1, true), true));
+        if (decoder == nullptr)
+            return;
+
+        decoderStart = (juce::int64)first * spf;
+        decoderPosition = decoderStart;
+
+        int* skip[2] = { skipBuffer.get(), skipBuffer.get() + skipLength };
+        const int skipChannels = juce::jmin(2, (int)decoder->numChannels);
+        while (decoderPosition < sample) {
+            const int num = (int)juce::jmin((juce::int64)skipLength, sample - decoderPosition);
+            decoder->readSamples(skip, skipChannels, 0, decoderPosition - decoderStart, num);
+            decoderPosition += num;
+        }
+    }
+
+    static constexpr int skipLength = 4096;
+
+    juce::File file;
+    std::shared_ptr<const Mp3FrameIndex> index;
+    juce::MP3AudioFormat format;
+    std::unique_ptr<juce::AudioFormatReader> decoder;
+    juce::int64 decoderStart = 0;
+    juce::int64 decoderPosition = -1;
+    juce::HeapBlock<int> skipBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IndexedMp3Reader)
+};
+#endif
+
+class Mp3FrameIndex::BuildJob : public juce::ThreadPoolJob
+{
+public:
+    explicit BuildJob(const juce::File& f)
+        : juce::ThreadPoolJob("Index " + f.getFullPathName()), file(f) {
+    }
+
+    // the file stays pending until the job is deleted, whether it ran or was removed
+    ~BuildJob() override {
+        const juce::ScopedLock sl(pendingLock);
+        pendingFiles.removeString(file.getFullPathName());
+    }
+
+    // queues a job unless one for this file is already pending; safe from any thread
+    static void queue(juce::ThreadPool& pool, const juce::File& f) {
+        {
+            const juce::ScopedLock sl(pendingLock);
+            if (pendingFiles.contains(f.getFullPathName()))
+                return;
+            pendingFiles.add(f.getFullPathName());
+        }
+        pool.addJob(new BuildJob(f), true);
+    }
+
+    JobStatus runJob() override {
+        bool notIndexable = false;
+        if (Mp3FrameIndex::load(file, notIndexable) != nullptr || notIndexable)
+            return jobHasFinished;
+
+        if (auto index = Mp3FrameIndex::scan(file, [this] { return shouldExit(); })) {
+            index->save(file);
+        }
+        else if (!shouldExit()) {
+            // an empty index for this size and time, so the file is not scanned on every load
+            Mp3FrameIndex empty;
+            empty.fileSize = file.getSize();
+            empty.modificationTime = file.getLastModificationTime().toMilliseconds();
+            empty.save(file);
+        }
+        return jobHasFinished;
+    }
+
+private:
+    static juce::CriticalSection pendingLock;
+    static juce::StringArray pendingFiles;
+
+    juce::File file;
+};
+
+juce::CriticalSection Mp3FrameIndex::BuildJob::pendingLock;
+juce::StringArray Mp3FrameIndex::BuildJob::pendingFiles;
+
+std::unique_ptr<juce::AudioFormatReader> Mp3FrameIndex::createReader(juce::AudioFormatManager& formatManager,
+    const juce::File& file, juce::ThreadPool* indexPool) {
+   #if JUCE_USE_MP3AUDIOFORMAT
+    if (file.hasFileExtension("mp3")) {
+        bool notIndexable = false;
+        if (auto index = load(file, notIndexable))
+            return std::make_unique<IndexedMp3Reader>(file, std::move(index));
+
+        if (indexPool != nullptr && !notIndexable)
+            BuildJob::queue(*indexPool, file);
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+        const juce::int64 length = readLengthFromHeader(file);
+        if (reader != nullptr && length > 0)
+            reader->lengthInSamples = length;
+        return reader;
+    }
+   #else
+    juce::ignoreUnused(indexPool);
+   #endif
+
+    return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file));
+}
+
+juce::File Mp3FrameIndex::getSidecarFile(const juce::File& file) {
+    return juce::File::getSpecialLocation(juce::File::currentExecutableFile).getParentDirectory()
+        .getChildFile("FrameIndex")
+        .getChildFile(juce::String::toHexString(file.getFullPathName().hashCode64()) + ".mp3index");
+}
+
+juce::int64 Mp3FrameIndex::readLengthFromHeader(const juce::File& file) {
+    juce::FileInputStream in(file);
+    if (in.failedToOpen())
+        return -1;
+
+    juce::uint8 id3[10] = {};
+    if (in.read(id3, 10) != 10)
+        return -1;
+    in.setPosition(skipId3v2(id3, 10));
+
+    // the tag sits in the first frame, within a few kilobytes of junk at most
+    juce::HeapBlock<juce::uint8> block(8192, true);
+    const int numRead = in.read(block.get(), 8192);
+    FrameHeader header;
+    const juce::int64 pos = findFrame(block.get(), numRead, 0, header);
+    if (pos < 0)
+        return -1;
+
+    const juce::int64 frames = readTagFrameCount(block.get() + pos, numRead - pos, header);
+    return frames > 0 ? frames * header.samplesPerFrame : -1;
+}
+
+std::shared_ptr<Mp3FrameIndex> Mp3FrameIndex::scan(const juce::File& file, const std::function<bool()>& shouldExit) {
+    juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+    const auto* data = static_cast<const juce::uint8*>(mapped.getData());
+    const juce::int64 size = (juce::int64)mapped.getSize();
+    if (data == nullptr)
+        return nullptr;
+
+    FrameHeader first;
+    juce::int64 pos = findFrame(data, size, skipId3v2(data, size), first);
+    if (pos < 0)
+        return nullptr;
+
+    // the header frame decodes to nothing; the decoder skips it as well
+    if (readTagFrameCount(data + pos, size - pos, first) >= 0)
+        pos += first.frameBytes;
+
+    auto index = std::make_shared<Mp3FrameIndex>();
+    index->fileSize = file.getSize();
+    index->modificationTime = file.getLastModificationTime().toMilliseconds();
+    index->sampleRate = first.sampleRate;
+    index->numChannels = first.numChannels;
+    index->samplesPerFrame = first.samplesPerFrame;
+    index->offsets.reserve((size_t)(size / juce::jmax(1, first.frameBytes)) + 16);
+
+    FrameHeader header;
+    while (pos + 4 <= size) {
+        if ((index->offsets.size() & 4095) == 0 && shouldExit && shouldExit())
+            return nullptr;
+
+        if (parseHeader(data + pos, header) && header.sameStreamAs(first)) {
+            if (pos + header.frameBytes > size)
+                break; // cut off at the end
+            index->offsets.push_back(pos);
+            pos += header.frameBytes;
+            continue;
+        }
+
+        // an ID3v1 or APE tag ends the audio; anything else is junk to resync past
+        if ((size - pos >= 3 && std::memcmp(data + pos, "TAG", 3) == 0)
+            || (size - pos >= 8 && std::memcmp(data + pos, "APETAGEX", 8) == 0))
+            break;
+
+        pos = findFrame(data, size, pos + 1, header);
+        if (pos < 0)
+            break;
+    }
+
+    if (index->offsets.empty())
+        return nullptr;
+    return index;
+}
+
+// Frame offsets are stored as the distance from the previous one, which mostly fits in two bytes.
+bool Mp3FrameIndex::save(const juce::File& file) const {
+    juce::MemoryOutputStream out;
+    out.writeInt(sidecarMagic);
+    out.writeInt(sidecarVersion);
+    out.writeInt64(fileSize);
+    out.writeInt64(modificationTime);
+    out.writeDouble(sampleRate);
+    out.writeInt(numChannels);
+    out.writeInt(samplesPerFrame);
+    out.writeInt(getNumFrames());
+
+    juce::int64 previous = 0;
+    for (auto offset : offsets) {
+        out.writeCompressedInt((int)(offset - previous));
+        previous = offset;
+    }
+
+    const juce::File sidecar = getSidecarFile(file);
+    if (!sidecar.getParentDirectory().createDirectory())
+        return false;
+
+    juce::TemporaryFile temp(sidecar);
+    if (!temp.getFile().replaceWithData(out.getData(), out.getDataSize()))
+        return false;
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+std::shared_ptr<const Mp3FrameIndex> Mp3FrameIndex::load(const juce::File& file) {
+    bool notIndexable = false;
+    return load(file, notIndexable);
+}
+
+std::shared_ptr<const Mp3FrameIndex> Mp3FrameIndex::load(const juce::File& file, bool& notIndexable) {
+    notIndexable = false;
+    juce::MemoryBlock block;
+    if (!getSidecarFile(file).loadFileAsData(block))
+        return nullptr;
+
+    juce::MemoryInputStream in(block, false);
+    if (in.readInt() != sidecarMagic || in.readInt() != sidecarVersion)
+        return nullptr;
+
+    auto index = std::make_shared<Mp3FrameIndex>();
+    index->fileSize = in.readInt64();
+    index->modificationTime = in.readInt64();
+    if (index->fileSize != file.getSize()
+        || index->modificationTime != file.getLastModificationTime().toMilliseconds())
+        return nullptr;
+
+    index->sampleRate = in.readDouble();
+    index->numChannels = in.readInt();
+    index->samplesPerFrame = in.readInt();
+    const int numFrames = in.readInt();
+    if (numFrames == 0 && in.getNumBytesRemaining() == 0) {
+        notIndexable = true;
+        return nullptr;
+    }
+    if (index->sampleRate <= 0.0 || numFrames <= 0 || index->samplesPerFrame <= 0)
+        return nullptr;
+
+    index->offsets.resize((size_t)numFrames);
+    juce::int64 offset = 0;
+    for (auto& frame : index->offsets) {
+        offset += in.readCompressedInt();
+        frame = offset;
+    }
+
+    if (in.getNumBytesRemaining() != 0 || offset >= index->fileSize)
+        return nullptr;
+    return index;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <JuceHeader.h>
+#include <functional>
+#include <vector>
+
+// Where every MPEG audio frame of an MP3 starts, so a reader can seek straight to the frame
+// holding a sample instead of scanning up to it, and the exact length is known without
+// decoding anything.
+//
+// The index comes from a single pass over the frame headers, run in the background the
+// first time a file is opened, and is kept in a small sidecar file next to the session.
+// A file the scan finds no frames in gets an empty sidecar, so it is not scanned again
+// until it changes. Until the index exists, a Xing, Info or VBRI header in the first frame still gives the exact
+// length. Samples are numbered the way the decoder numbers them: frame n starts at sample
+// n * samplesPerFrame, and the header frame is not counted.
+class Mp3FrameIndex
+{
+public:
+    // MP3s get an indexed reader when their index exists; otherwise the format's own reader
+    // with the length from the header, and the index is built on indexPool for next time.
+    // Anything else goes straight to the format manager.
+    static std::unique_ptr<juce::AudioFormatReader> createReader(juce::AudioFormatManager& formatManager,
+        const juce::File& file, juce::ThreadPool* indexPool);
+
+    // nullptr without a sidecar, or when the file has changed since it was written
+    static std::shared_ptr<const Mp3FrameIndex> load(const juce::File& file);
+    // as load(), and sets notIndexable when the sidecar records that the file has no frames
+    static std::shared_ptr<const Mp3FrameIndex> load(const juce::File& file, bool& notIndexable);
+    // nullptr if the file is not MPEG audio, or when shouldExit() returns true
+    static std::shared_ptr<Mp3FrameIndex> scan(const juce::File& file, const std::function<bool()>& shouldExit = {});
+    bool save(const juce::File& file) const;
+
+    // the length a Xing, Info or VBRI header gives, in samples; -1 without one
+    static juce::int64 readLengthFromHeader(const juce::File& file);
+
+    int getNumFrames() const { return (int)offsets.size(); }
+    juce::int64 getFrameOffset(int frame) const { return offsets[(size_t)frame]; }
+    juce::int64 getLengthInSamples() const { return (juce::int64)getNumFrames() * samplesPerFrame; }
+    int getSamplesPerFrame() const { return samplesPerFrame; }
+    double getSampleRate() const { return sampleRate; }
+    int getNumChannels() const { return numChannels; }
+
+private:
+    class BuildJob;
+
+    static juce::File getSidecarFile(const juce::File& file);
+
+    std::vector<juce::int64> offsets;
+    juce::int64 fileSize = 0;
+    juce::int64 modificationTime = 0;
+    double sampleRate = 0.0;
+    int numChannels = 2;
+    int samplesPerFrame = 1152;
+};
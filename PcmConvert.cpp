@@ -0,0 +1,246 @@
+#include "PcmConvert.h"
+#include "SimdSupport.h"
+#include <cstring>
+
+namespace PcmConvert
+{
+namespace
+{
+    // every format is widened to a left-aligned int32 first, so one scale serves them all
+    // and each kernel gives bit-identical results
+    constexpr float int32Scale = 1.0f / 2147483648.0f;
+
+    inline int32_t loadScalar(Format format, const uint8_t* p) {
+        switch (format) {
+        case Format::Int16: return (int32_t)(((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 24));
+        case Format::Int24: return (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+        case Format::Int32:
+        default:            return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        }
+    }
+
+    void planarScalar(Format format, const uint8_t* src, float* dest, int start, int numSamples) {
+        const int bps = getBytesPerSample(format);
+        for (int i = start; i < numSamples; ++i)
+            dest[i] = (float)loadScalar(format, src + (size_t)i * bps) * int32Scale;
+    }
+
+    void stereoScalar(Format format, const uint8_t* src, float* left, float* right, int start, int numFrames) {
+        const int bps = getBytesPerSample(format);
+        for (int i = start; i < numFrames; ++i) {
+            const uint8_t* frame = src + (size_t)i * 2 * bps;
+            left[i] = (float)loadScalar(format, frame) * int32Scale;
+            right[i] = (float)loadScalar(format, frame + bps) * int32Scale;
+        }
+    }
+
+#if SIMDSUPPORT_X86
+    //==============================================================================
+    // SSE2: four samples per load. 24-bit has no byte shuffle here, so it is gathered.
+    template <Format F>
+    inline __m128 sse2Load4(const uint8_t* p) {
+        __m128i x;
+        if (F == Format::Int16)
+            x = _mm_unpacklo_epi16(_mm_setzero_si128(), _mm_loadl_epi64((const __m128i*)p));
+        else if (F == Format::Int24)
+            x = _mm_setr_epi32(loadScalar(F, p), loadScalar(F, p + 3), loadScalar(F, p + 6), loadScalar(F, p + 9));
+        else
+            x = _mm_loadu_si128((const __m128i*)p);
+        return _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(int32Scale));
+    }
+
+    template <Format F>
+    void planarSse2(const uint8_t* src, float* dest, int numSamples) {
+        const int bps = getBytesPerSample(F);
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            _mm_storeu_ps(dest + i, sse2Load4<F>(src + (size_t)i * bps));
+        planarScalar(F, src, dest, i, numSamples);
+    }
+
+    template <Format F>
+    void stereoSse2(const uint8_t* src, float* left, float* right, int numFrames) {
+        const int bps = getBytesPerSample(F);
+        int i = 0;
+        for (; i + 4 <= numFrames; i += 4) {
+            const uint8_t* p = src + (size_t)i * 2 * bps;
+            const __m128 a = sse2Load4<F>(p);
+            const __m128 b = sse2Load4<F>(p + 4 * bps);
+            _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+        stereoScalar(F, src, left, right, i, numFrames);
+    }
+
+    //==============================================================================
+    // AVX2: eight samples per load. 24-bit is spread into the top of each 32-bit lane with a
+    // byte shuffle, which reads four bytes past the last sample, so it needs a wider margin.
+    template <Format F>
+    constexpr int avx2LoadSpan() { return F == Format::Int24 ? 10 : 8; }
+
+    template <Format F>
+    SIMDSUPPORT_AVX2 inline __m256 avx2Load8(const uint8_t* p) {
+        __m256i x;
+        if (F == Format::Int16) {
+            x = _mm256_slli_epi32(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)p)), 16);
+        }
+        else if (F == Format::Int24) {
+            const __m128i spread = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+            const __m128i lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)p), spread);
+            const __m128i hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 12)), spread);
+            x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        }
+        else {
+            x = _mm256_loadu_si256((const __m256i*)p);
+        }
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(x), _mm256_set1_ps(int32Scale));
+    }
+
+    template <Format F>
+    SIMDSUPPORT_AVX2 void planarAvx2(const uint8_t* src, float* dest, int numSamples) {
+        const int bps = getBytesPerSample(F);
+        int i = 0;
+        for (; i + avx2LoadSpan<F>() <= numSamples; i += 8)
+            _mm256_storeu_ps(dest + i, avx2Load8<F>(src + (size_t)i * bps));
+        planarScalar(F, src, dest, i, numSamples);
+    }
+
+    template <Format F>
+    SIMDSUPPORT_AVX2 void stereoAvx2(const uint8_t* src, float* left, float* right, int numFrames) {
+        const int bps = getBytesPerSample(F);
+        const int numSamples = numFrames * 2;
+        int i = 0;
+        for (; 2 * i + 8 + avx2LoadSpan<F>() <= numSamples; i += 8) {
+            const uint8_t* p = src + (size_t)i * 2 * bps;
+            const __m256 a = avx2Load8<F>(p);
+            const __m256 b = avx2Load8<F>(p + 8 * bps);
+
+            // per 128-bit lane: L0 L1 L4 L5 | L2 L3 L6 L7, then put the 64-bit pairs back in order
+            const __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm256_storeu_ps(left + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0))));
+            _mm256_storeu_ps(right + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0))));
+        }
+        stereoScalar(F, src, left, right, i, numFrames);
+    }
+#endif
+
+    Kernel resolve(Kernel kernel) {
+       #if SIMDSUPPORT_X86
+        return kernel == Kernel::Avx2 && getBestKernel() != Kernel::Avx2 ? Kernel::Sse2 : kernel;
+       #else
+        (void)kernel;
+        return Kernel::Scalar;
+       #endif
+    }
+
+    template <Format F>
+    void planarDispatch(const uint8_t* src, float* dest, int numSamples, Kernel kernel) {
+        switch (resolve(kernel)) {
+       #if SIMDSUPPORT_X86
+        case Kernel::Avx2: planarAvx2<F>(src, dest, numSamples); break;
+        case Kernel::Sse2: planarSse2<F>(src, dest, numSamples); break;
+       #endif
+        default:           planarScalar(F, src, dest, 0, numSamples); break;
+        }
+    }
+
+    template <Format F>
+    void stereoDispatch(const uint8_t* src, float* left, float* right, int numFrames, Kernel kernel) {
+        switch (resolve(kernel)) {
+       #if SIMDSUPPORT_X86
+        case Kernel::Avx2: stereoAvx2<F>(src, left, right, numFrames); break;
+        case Kernel::Sse2: stereoSse2<F>(src, left, right, numFrames); break;
+       #endif
+        default:           stereoScalar(F, src, left, right, 0, numFrames); break;
+        }
+    }
+}
+
+int getBytesPerSample(Format format) {
+    switch (format) {
+    case Format::Int16: return 2;
+    case Format::Int24: return 3;
+    case Format::Int32:
+    default:            return 4;
+    }
+}
+
+Kernel getBestKernel() {
+   #if SIMDSUPPORT_X86
+    static const Kernel best = SimdSupport::hasAvx2() ? Kernel::Avx2 : Kernel::Sse2;
+    return best;
+   #else
+    return Kernel::Scalar;
+   #endif
+}
+
+Kernel getBestKernel(Format format) {
+    const Kernel best = getBestKernel();
+    return format == Format::Int16 && best == Kernel::Avx2 ? Kernel::Sse2 : best;
+}
+
+const char* getKernelName(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::Avx2: return "AVX2";
+    case Kernel::Sse2: return "SSE2";
+    case Kernel::Scalar:
+    default:           return "scalar";
+    }
+}
+
+void planarToFloat(Format format, const void* source, float* dest, int numSamples) {
+    planarToFloat(format, source, dest, numSamples, getBestKernel(format));
+}
+
+void planarToFloat(Format format, const void* source, float* dest, int numSamples, Kernel kernel) {
+    const auto* src = static_cast<const uint8_t*>(source);
+    switch (format) {
+    case Format::Int16: planarDispatch<Format::Int16>(src, dest, numSamples, kernel); break;
+    case Format::Int24: planarDispatch<Format::Int24>(src, dest, numSamples, kernel); break;
+    case Format::Int32: planarDispatch<Format::Int32>(src, dest, numSamples, kernel); break;
+    }
+}
+
+void interleavedToFloat(Format format, const void* source, int numSourceChannels,
+    float* const* dest, int numDestChannels, int numFrames) {
+    interleavedToFloat(format, source, numSourceChannels, dest, numDestChannels, numFrames, getBestKernel(format));
+}
+
+void interleavedToFloat(Format format, const void* source, int numSourceChannels,
+    float* const* dest, int numDestChannels, int numFrames, Kernel kernel) {
+    if (numDestChannels <= 0 || numFrames <= 0)
+        return;
+
+    const auto* src = static_cast<const uint8_t*>(source);
+
+    if (numSourceChannels == 1) {
+        planarToFloat(format, src, dest[0], numFrames, kernel);
+        for (int ch = 1; ch < numDestChannels; ++ch)
+            std::memcpy(dest[ch], dest[0], sizeof(float) * (size_t)numFrames);
+        return;
+    }
+
+    int done = 0;
+    if (numSourceChannels == 2 && numDestChannels >= 2) {
+        switch (format) {
+        case Format::Int16: stereoDispatch<Format::Int16>(src, dest[0], dest[1], numFrames, kernel); break;
+        case Format::Int24: stereoDispatch<Format::Int24>(src, dest[0], dest[1], numFrames, kernel); break;
+        case Format::Int32: stereoDispatch<Format::Int32>(src, dest[0], dest[1], numFrames, kernel); break;
+        }
+        done = 2;
+    }
+
+    // other layouts are rare enough to stay scalar
+    const int bps = getBytesPerSample(format);
+    const size_t frameBytes = (size_t)bps * (size_t)numSourceChannels;
+    for (int ch = done; ch < numDestChannels; ++ch) {
+        if (ch >= numSourceChannels) {
+            std::memset(dest[ch], 0, sizeof(float) * (size_t)numFrames);
+            continue;
+        }
+        for (int i = 0; i < numFrames; ++i)
+            dest[ch][i] = (float)loadScalar(format, src + (size_t)i * frameBytes + (size_t)ch * bps) * int32Scale;
+    }
+}
+}
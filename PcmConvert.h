@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Integer PCM to float conversion for the deck's reader path. The kernel (scalar, SSE2 or
+// AVX2) is picked per format at run time from what the CPU supports and what measured
+// fastest. Deliberately free of JUCE so the benchmark can build it on its own.
+namespace PcmConvert
+{
+    enum class Format {
+        Int16,
+        Int24,
+        Int32
+    };
+
+    enum class Kernel {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    int getBytesPerSample(Format format);
+
+    // the widest kernel the CPU supports
+    Kernel getBestKernel();
+    // the one the conversions below use by default: 16-bit stays on SSE2, where AVX2's
+    // widening load measured no faster
+    Kernel getBestKernel(Format format);
+    const char* getKernelName(Kernel kernel);
+
+    // little-endian samples of one channel, one after another -> float in [-1, 1)
+    void planarToFloat(Format format, const void* source, float* dest, int numSamples);
+    void planarToFloat(Format format, const void* source, float* dest, int numSamples, Kernel kernel);
+
+    // numSourceChannels little-endian samples per frame -> one float array per destination
+    // channel. A mono source feeds every destination; extra source channels are skipped.
+    void interleavedToFloat(Format format, const void* source, int numSourceChannels,
+        float* const* dest, int numDestChannels, int numFrames);
+    void interleavedToFloat(Format format, const void* source, int numSourceChannels,
+        float* const* dest, int numDestChannels, int numFrames, Kernel kernel);
+}
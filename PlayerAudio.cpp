@@ -1,52 +1,469 @@
 #include "PlayerAudio.h"
+#include "DecodedTrackAudioSource.h"
+#include "MappedTrackAudioSource.h"
+#include "Mp3FrameIndex.h"
+#include "Wave64AudioFormat.h"
 #include <fstream>
 #include <string>
 #include <iostream>
 
 
+class PlayerAudio::NextTrackJob : public juce::ThreadPoolJob
+{
+public:
+    NextTrackJob(PlayerAudio& o, const juce::File& f)
+        : juce::ThreadPoolJob("Open next track"), owner(o), file(f) {
+    }
+
+    JobStatus runJob() override {
+        owner.prepareNextTrack(file, *this);
+        return jobHasFinished;
+    }
+
+private:
+    PlayerAudio& owner;
+    juce::File file;
+};
+
 PlayerAudio::PlayerAudio() {
     formatManager.registerBasicFormats();
+    formatManager.registerFormat(new Wave64AudioFormat(), false);
     transportSource.setLooping(false);
+    queueSource.onAdvance = [this]() {
+        // audio thread, on the splice: the next track may run at a different rate
+        const double rate = queuedSampleRate.load();
+        playbackSampleRate = rate;
+        resampler.setSourceSampleRate(rate);
+        triggerAsyncUpdate();
+    };
 }
 
 PlayerAudio::~PlayerAudio() {
+    cancelPendingUpdate();
+    transportSource.setSource(NULL);
+    cancelNextTrack();
+    queueSource.setCurrent(nullptr);
     releaseResources();
 }
 
 juce::String PlayerAudio::formatTime(double seconds) {
-    int minutes = (int)(seconds / 60);
-    int secs = (int)(seconds) % 60;
+    const juce::int64 total = (juce::int64)juce::jmax(0.0, seconds);
+    const int hours = (int)(total / 3600);
+    const int minutes = (int)(total / 60 % 60);
+    const int secs = (int)(total % 60);
+    if (hours > 0)
+        return juce::String::formatted("%d:%02d:%02d", hours, minutes, secs);
     return juce::String::formatted("%02d:%02d", minutes, secs);
 }
 
 
 void PlayerAudio::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
-    transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    preparedBlockSize = samplesPerBlockExpected;
+    preparedSampleRate = sampleRate;
+    timeStretch.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    deckGain.prepare(sampleRate, 0.02);
+    equalizer.prepare(sampleRate, 2);
+    effectChain.prepare(sampleRate, samplesPerBlockExpected, 2);
+
+    // flat grains with raised-cosine edges a quarter of their length each
+    grainLength = juce::jmax(256, (int)(scrubGrainSeconds * sampleRate));
+    grainWindow.allocate((size_t)grainLength, false);
+    const int fade = grainLength / 4;
+    for (int i = 0; i < grainLength; ++i) {
+        const int edge = juce::jmin(i, grainLength - 1 - i);
+        grainWindow[i] = edge >= fade ? 1.0f
+            : 0.5f - 0.5f * std::cos(juce::MathConstants<float>::pi * (float)edge / (float)fade);
+    }
+    grainPosition = grainLength;
 }
 
 void PlayerAudio::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
-    transportSource.getNextAudioBlock(bufferToFill);
+    const int epoch = commandEpoch.load();
+    const juce::int64 blockStart = masterClock != nullptr ? masterClock->getSamplePosition() : 0;
+    const juce::int64 blockEnd = blockStart + bufferToFill.numSamples;
+
+    // anything still scheduled for the previous track is void
+    if (scheduledEpoch != epoch) {
+        numScheduledCommands = 0;
+        scheduledEpoch = epoch;
+
+        // and so is a drag on its position slider
+        scrubbing = false;
+        scrubReleased = false;
+        grainPosition = grainLength;
+    }
+
+    commandQueue.drain([this, epoch, blockStart](const DeckCommand& command) {
+        lastDrainedCommand = command.serial;
+        // transport commands for a previous track are void; settings carry over
+        if (command.epoch != epoch && command.isTransport())
+            return;
+
+        if (masterClock != nullptr && command.atSample > blockStart)
+            scheduleCommand(command);
+        else
+            applyCommand(command);
+    });
+
+    // split the block at every scheduled command that falls inside it
+    int done = 0;
+    for (int due = findDueCommand(blockEnd); due >= 0; due = findDueCommand(blockEnd)) {
+        const DeckCommand command = scheduledCommands[(size_t)due];
+        std::move(scheduledCommands.begin() + due + 1, scheduledCommands.begin() + numScheduledCommands,
+            scheduledCommands.begin() + due);
+        --numScheduledCommands;
+
+        const int offset = (int)juce::jlimit((juce::int64)done, (juce::int64)bufferToFill.numSamples, command.atSample - blockStart);
+        renderSegment(bufferToFill, done, offset - done);
+        done = offset;
+        applyCommand(command);
+    }
+
+    renderSegment(bufferToFill, done, bufferToFill.numSamples - done);
+    publishState(epoch);
+}
+
+bool PlayerAudio::needsRender() const {
+    return deckPlaying || scrubbing || numScheduledCommands > 0 || commandQueue.hasPending()
+        || publishedEpoch != commandEpoch.load();
+}
+
+void PlayerAudio::scheduleCommand(const DeckCommand& command) {
+    if (numScheduledCommands == maxScheduledCommands) {
+        jassertfalse; // too many pending; better early than never
+        applyCommand(command);
+        return;
+    }
+    scheduledCommands[(size_t)numScheduledCommands++] = command;
+}
+
+// Every command is applied up to the returned serial: the last one drained, unless an earlier
+// one is still waiting for its sample. Published, so a scheduled seek does not count as done
+// before the playhead has moved.
+juce::uint32 PlayerAudio::getAppliedCommand() const {
+    juce::uint32 applied = lastDrainedCommand;
+    for (int i = 0; i < numScheduledCommands; ++i) {
+        const juce::uint32 before = scheduledCommands[(size_t)i].serial - 1;
+        if ((juce::int32)(before - applied) < 0)
+            applied = before;
+    }
+    return applied;
+}
+
+// the earliest scheduled command before blockEnd, the first posted one on a tie; -1 if none
+int PlayerAudio::findDueCommand(juce::int64 blockEnd) const {
+    int due = -1;
+    for (int i = 0; i < numScheduledCommands; ++i)
+        if (scheduledCommands[(size_t)i].atSample < blockEnd
+            && (due < 0 || scheduledCommands[(size_t)i].atSample < scheduledCommands[(size_t)due].atSample))
+            due = i;
+    return due;
+}
+
+void PlayerAudio::renderSegment(const juce::AudioSourceChannelInfo& block, int offset, int numSamples) {
+    if (numSamples <= 0)
+        return;
+
+    const juce::AudioSourceChannelInfo segment(block.buffer, block.startSample + offset, numSamples);
+
+    // the transport drops out of playing by itself at the end of the track or when its source is swapped
+    if (deckPlaying && !transportSource.isPlaying()) {
+        deckPlaying = false;
+        stopRequested = false;
+        seekAfterStop = false;
+    }
+
+    if (!deckPlaying && !scrubbing) {
+        // nothing to glide while silent; resume straight at the current volume
+        deckGain.setCurrentAndTarget(deckGain.getTarget());
+        segment.clearActiveBufferRegion();
+        return;
+    }
+
+    if (scrubbing) {
+        renderScrub(segment);
+    }
+    else {
+        timeStretch.getNextAudioBlock(segment);
+
+        // backwards into the start of the track; fade out like a pause
+        if (reverser.hasReachedStart())
+            stopRequested = true;
+    }
+
+    if (equalizer.isActive() || effectChain.isActive()) {
+        float* channels[DeckEffectChain::maxChannels] = {};
+        const int numChannels = juce::jmin(segment.buffer->getNumChannels(), (int)DeckEffectChain::maxChannels);
+        for (int ch = 0; ch < numChannels; ++ch)
+            channels[ch] = segment.buffer->getWritePointer(ch, segment.startSample);
+        equalizer.process(channels, numChannels, numSamples);
+        effectChain.process(channels, numChannels, numSamples);
+    }
+
+    const GainRamp::Block gain = deckGain.advance(numSamples);
+    for (int ch = 0; ch < segment.buffer->getNumChannels(); ++ch)
+        GainRamp::apply(gain, segment.buffer->getWritePointer(ch, segment.startSample), numSamples);
+
+    if (stopRequested) {
+        // fade the rest of the block out instead of cutting it, then park the deck
+        segment.buffer->applyGainRamp(segment.startSample, numSamples, 1.0f, 0.0f);
+        deckPlaying = false;
+        stopRequested = false;
+
+        if (seekAfterStop) {
+            seekToSample(0);
+            seekAfterStop = false;
+        }
+        timeStretch.reset();
+        equalizer.reset();
+        effectChain.reset();
+    }
+}
+
+// Audio thread, while the position slider is held: short windowed grains from the latest
+// drag position, through the whole deck chain. Only a new grain seeks, so however many drag
+// events arrive the decoder sees at most one seek per grain; a slider held still goes quiet.
+void PlayerAudio::renderScrub(const juce::AudioSourceChannelInfo& segment) {
+    const juce::int64 length = transportSource.getTotalLength();
+    int done = 0;
+
+    while (done < segment.numSamples) {
+        if (grainPosition >= grainLength) {
+            const juce::AudioSourceChannelInfo rest(segment.buffer, segment.startSample + done, segment.numSamples - done);
+
+            if (scrubReleased) {
+                // the last grain has faded out; carry on from where the slider was let go
+                scrubbing = false;
+                scrubReleased = false;
+                seekToSample(scrubFinal);
+                if (deckPlaying)
+                    timeStretch.getNextAudioBlock(rest);
+                else
+                    rest.clearActiveBufferRegion();
+                return;
+            }
+
+            const juce::int64 target = (juce::int64)(juce::jlimit(0.0, 1.0, scrubTarget.load()) * (double)length);
+            if (target == grainStart) {
+                rest.clearActiveBufferRegion();
+                return;
+            }
+
+            seekToSample(target);
+            if (!transportSource.isPlaying())
+                transportSource.start();
+            grainStart = target;
+            grainPosition = 0;
+        }
+
+        const int num = juce::jmin(segment.numSamples - done, grainLength - grainPosition);
+        const juce::AudioSourceChannelInfo grain(segment.buffer, segment.startSample + done, num);
+        timeStretch.getNextAudioBlock(grain);
+        for (int ch = 0; ch < grain.buffer->getNumChannels(); ++ch)
+            juce::FloatVectorOperations::multiply(grain.buffer->getWritePointer(ch, grain.startSample),
+                grainWindow + grainPosition, num);
+
+        grainPosition += num;
+        done += num;
+    }
+}
+
+// Audio thread. The transport runs in the file's own samples; the resampler behind it does
+// the rate conversion, so seconds are converted here rather than by the transport.
+void PlayerAudio::seekToSample(juce::int64 sample) {
+    transportSource.setNextReadPosition(juce::jlimit((juce::int64)0, transportSource.getTotalLength(), sample));
+    resampler.reset();
+    timeStretch.reset();
+}
+
+void PlayerAudio::publishState(int epoch) {
+    const double rate = playbackSampleRate.load();
+    auto& state = publishedState.getWriteState();
+    state.positionSeconds = rate > 0.0 ? transportSource.getNextReadPosition() / rate : 0.0;
+    state.lengthSeconds = rate > 0.0 ? transportSource.getTotalLength() / rate : 0.0;
+    state.positionSamples = transportSource.getNextReadPosition();
+    state.playing = deckPlaying;
+    state.epoch = epoch;
+    state.lastCommand = getAppliedCommand();
+    publishedState.publish();
+    publishedEpoch = epoch;
+}
+
+void PlayerAudio::postCommand(DeckCommand::Type type, double value, juce::int64 atSample, int index) {
+    DeckCommand command;
+    command.type = type;
+    command.value = value;
+    command.epoch = commandEpoch.load();
+    command.atSample = atSample;
+    command.index = index;
+    command.serial = ++postedCommands;
+
+    if (command.movesPlayhead())
+        lastSeekCommand = command.serial;
+
+    commandQueue.push(command);
+}
+
+// A snapshot from before the last load or the last seek would make the playhead jump back.
+bool PlayerAudio::isStateCurrent(const DeckState& state) const {
+    return state.epoch == commandEpoch.load() && (juce::int32)(state.lastCommand - lastSeekCommand) >= 0;
+}
+
+bool PlayerAudio::isPlaying() const {
+    const auto& state = publishedState.read();
+    return state.epoch == commandEpoch.load() && state.playing;
+}
+
+// Audio thread only, at the start of a block or at a scheduled sample inside it.
+void PlayerAudio::applyCommand(const DeckCommand& command) {
+    const double rate = playbackSampleRate.load();
+    const juce::int64 length = transportSource.getTotalLength();
+
+    switch (command.type) {
+    case DeckCommand::Type::Play:
+    case DeckCommand::Type::JumpAndPlay:
+        if (command.type == DeckCommand::Type::JumpAndPlay)
+            seekToSample((juce::int64)command.value);
+        if (!deckPlaying) {
+            timeStretch.reset();
+            transportSource.start();
+            deckPlaying = true;
+        }
+        stopRequested = false;
+        seekAfterStop = false;
+        break;
+
+    case DeckCommand::Type::Pause:
+        stopRequested = deckPlaying;
+        break;
+
+    case DeckCommand::Type::Stop:
+        if (deckPlaying) {
+            stopRequested = true;
+            seekAfterStop = true;
+        }
+        else {
+            seekToSample(0);
+        }
+        break;
+
+    case DeckCommand::Type::Restart:
+        seekToSample(0);
+        if (!deckPlaying) {
+            transportSource.start();
+            deckPlaying = true;
+        }
+        stopRequested = false;
+        seekAfterStop = false;
+        break;
+
+    case DeckCommand::Type::Seek:
+        seekToSample((juce::int64)(juce::jmax(0.0, command.value) * rate));
+        break;
+
+    case DeckCommand::Type::SeekNormalized:
+        seekToSample((juce::int64)(juce::jlimit(0.0, 1.0, command.value) * (double)length));
+        break;
+
+    case DeckCommand::Type::SeekSample:
+        // a double holds every sample index up to 2^53, far beyond any recording
+        seekToSample((juce::int64)command.value);
+        break;
+
+    case DeckCommand::Type::SeekRelative:
+        seekToSample(transportSource.getNextReadPosition() + (juce::int64)(command.value * rate));
+        break;
+
+    case DeckCommand::Type::SeekToEnd:
+        seekToSample(length);
+        break;
+
+    case DeckCommand::Type::SetGain:
+        deckGain.setTarget((float)command.value);
+        break;
+
+    case DeckCommand::Type::SetSpeed:
+        timeStretch.setSpeed(command.value);
+        break;
+
+    case DeckCommand::Type::SetEqLow:
+        equalizer.setBandGainDb(DeckEqualizer::Band::Low, (float)command.value);
+        break;
+
+    case DeckCommand::Type::SetEqMid:
+        equalizer.setBandGainDb(DeckEqualizer::Band::Mid, (float)command.value);
+        break;
+
+    case DeckCommand::Type::SetEqHigh:
+        equalizer.setBandGainDb(DeckEqualizer::Band::High, (float)command.value);
+        break;
+
+    case DeckCommand::Type::SetFilter:
+        equalizer.setFilterPosition((float)command.value);
+        break;
+
+    case DeckCommand::Type::ScrubStart:
+        if (!scrubbing) {
+            scrubbing = true;
+            grainStart = -1;
+            grainPosition = grainLength;
+            // grains are pulled through the transport like playback
+            transportSource.start();
+        }
+        scrubReleased = false;
+        break;
+
+    case DeckCommand::Type::ScrubEnd:
+        scrubFinal = (juce::int64)(juce::jlimit(0.0, 1.0, command.value) * (double)length);
+        if (scrubbing)
+            scrubReleased = true;
+        else
+            seekToSample(scrubFinal);
+        break;
+
+    case DeckCommand::Type::SetReverse:
+        reverser.setReversed(command.value != 0.0);
+        break;
+
+    case DeckCommand::Type::SetEffectLayout:
+        effectChain.setLayout(DeckEffectChain::Layout::unpack((int)command.value));
+        break;
+
+    case DeckCommand::Type::SetEffectParameter:
+        effectChain.setParameter((DeckEffectChain::Effect)(command.index / DeckEffectChain::maxParameters),
+            (DeckEffectChain::Parameter)(command.index % DeckEffectChain::maxParameters), (float)command.value);
+        break;
+    }
 }
 
 void PlayerAudio::releaseResources() {
-    transportSource.releaseResources();
+    timeStretch.releaseResources();
 }
 
 bool PlayerAudio::loadFile(const juce::File& file) {
     if (file.existsAsFile()) {
-        if (auto* reader = formatManager.createReaderFor(file)) {
-            transportSource.stop();
+        double rate = 0.0;
+        int channels = 2;
+        bool inMemory = false;
+        if (auto source = openSource(file, rate, channels, inMemory)) {
+            // drop whatever was still queued for the old track
+            ++commandEpoch;
             transportSource.setSource(NULL);
+            cancelNextTrack();
+            playlistIndex = -1;
+            // a reverse toggle still reaches the queue from the audio thread while detached
+            queueSource.setCurrent(nullptr);
+            loopSource.reset();
+            readAheadSource.reset();
             readerSource.reset();
 
-            readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
+            readerSource = std::move(source);
 
-            currentSampleRate = reader->sampleRate;
+            currentSampleRate = rate;
+            numSourceChannels = channels;
+            sourceInMemory = inMemory;
 
-            transportSource.setSource(readerSource.get(),
-                0,
-                NULL,
-                currentSampleRate * currentSpeed);
+            attachSource();
 
             clearMarkers();
             clearTrackMarkers();
@@ -113,65 +530,232 @@ void PlayerAudio::addtoPlaylist(const juce::Array<juce::File>& files) {
         playlist.add(f);
     }
 
+    queueNextTrack();
 }
 
 void PlayerAudio::loadFromPlaylist(int i) {
+    if (i < 0 || i >= playlist.size())
+        return;
+
     juce::File file(playlist[i]);
-    loadFile(file);
+    if (loadFile(file)) {
+        playlistIndex = i;
+        queueNextTrack();
+    }
+}
+
+bool PlayerAudio::removeFromPlaylist(int i) {
+    if (i < 0 || i >= playlist.size() || i == playlistIndex)
+        return false;
+
+    playlist.remove(i);
+    if (i < playlistIndex) {
+        --playlistIndex;
+    }
+    else if (i == playlistIndex + 1) {
+        // it may already be prepared as the next track
+        if (withdrawNextTrack())
+            queueNextTrack();
+        else
+            --playlistIndex; // already playing it; handleAsyncUpdate() moves on from here
+    }
+    return true;
+}
+
+void PlayerAudio::queueNextTrack() {
+    if (loaderPool == nullptr || preparedBlockSize <= 0 || playlistIndex < 0)
+        return;
+
+    const int nextIndex = playlistIndex + 1;
+    if (nextIndex >= playlist.size() || queueSource.hasNext())
+        return;
+
+    if (nextTrackJob != NULL) {
+        if (loaderPool->contains(nextTrackJob.get()))
+            return;
+        nextTrackJob.reset();
+    }
+
+    nextTrackJob = std::make_unique<NextTrackJob>(*this, playlist[nextIndex]);
+    loaderPool->addJob(nextTrackJob.get(), false);
+}
+
+// Runs on the loader pool: opens the file and fills its read-ahead buffer so the
+// audio thread can switch to it on the last sample of the current track.
+void PlayerAudio::prepareNextTrack(const juce::File& file, juce::ThreadPoolJob& job) {
+    double rate = 0.0;
+    int channels = 2;
+    bool inMemory = false;
+    auto newReaderSource = openSource(file, rate, channels, inMemory);
+    if (newReaderSource == NULL || job.shouldExit())
+        return;
+
+    std::unique_ptr<ReadAheadAudioSource> newReadAhead;
+    juce::PositionableAudioSource* source = newReaderSource.get();
+
+    if (readAheadThread != nullptr && !inMemory) {
+        newReadAhead = std::make_unique<ReadAheadAudioSource>(source, *readAheadThread,
+            readAheadSamples, juce::jmax(2, channels));
+        source = newReadAhead.get();
+    }
+
+    auto newLoopSource = std::make_unique<LoopingAudioSource>(source, 2);
+    newLoopSource->setReadAheadSource(newReadAhead.get());
+    if (newReadAhead != nullptr)
+        newReadAhead->setReverseFlag(&reverser.getReversedFlag());
+    newLoopSource->setCrossfadeLength((int)(loopCrossfadeSeconds * rate));
+    newLoopSource->prepareToPlay(preparedBlockSize, preparedSampleRate);
+    newLoopSource->setNextReadPosition(0);
+
+    if (job.shouldExit())
+        return;
+
+    const juce::ScopedLock sl(nextTrackLock);
+    nextReaderSource = std::move(newReaderSource);
+    nextReadAheadSource = std::move(newReadAhead);
+    nextLoopSource = std::move(newLoopSource);
+    nextFile = file;
+    nextSampleRate = rate;
+    nextNumChannels = channels;
+    nextSourceInMemory = inMemory;
+    queuedSampleRate = rate;
+
+    queueSource.setNext(nextLoopSource.get());
+}
+
+// Only call while the transport is detached, so the queue is no longer rendering. The audio
+// thread can still read the queue's position when it applies a reverse toggle, so the caller
+// must also clear the current track before freeing it.
+void PlayerAudio::cancelNextTrack() {
+    if (nextTrackJob != NULL) {
+        if (loaderPool != nullptr)
+            loaderPool->removeJob(nextTrackJob.get(), true, 5000);
+        nextTrackJob.reset();
+    }
+
+    queueSource.takeNext();
+    if (queueSource.consumeAdvance())
+        queueSource.setCurrent(loopSource.get());
+
+    const juce::ScopedLock sl(nextTrackLock);
+    nextLoopSource.reset();
+    nextReadAheadSource.reset();
+    nextReaderSource.reset();
+    nextFile = juce::File();
+}
+
+// Drops the prepared next track while the current one keeps playing. False if the audio
+// thread has already switched to it; handleAsyncUpdate() then takes it over as usual.
+bool PlayerAudio::withdrawNextTrack() {
+    if (nextTrackJob != NULL) {
+        if (loaderPool != nullptr)
+            loaderPool->removeJob(nextTrackJob.get(), true, 5000);
+        nextTrackJob.reset();
+    }
+
+    // with the job gone, a prepared track that is no longer queued is the audio thread's
+    const bool taken = queueSource.takeNext() != nullptr;
+
+    const juce::ScopedLock sl(nextTrackLock);
+    if (!taken && nextLoopSource != nullptr)
+        return false;
+
+    nextLoopSource.reset();
+    nextReadAheadSource.reset();
+    nextReaderSource.reset();
+    nextFile = juce::File();
+    return true;
+}
+
+// The audio thread already switched to the next track; move the bookkeeping over to it.
+void PlayerAudio::handleAsyncUpdate() {
+    if (!queueSource.consumeAdvance())
+        return;
+
+    std::unique_ptr<juce::PositionableAudioSource> oldReaderSource;
+    std::unique_ptr<ReadAheadAudioSource> oldReadAheadSource;
+    std::unique_ptr<LoopingAudioSource> oldLoopSource;
+    double rate;
+
+    {
+        const juce::ScopedLock sl(nextTrackLock);
+        oldLoopSource = std::move(loopSource);
+        oldReadAheadSource = std::move(readAheadSource);
+        oldReaderSource = std::move(readerSource);
+
+        loopSource = std::move(nextLoopSource);
+        readAheadSource = std::move(nextReadAheadSource);
+        readerSource = std::move(nextReaderSource);
+        loadedFile = nextFile;
+        rate = nextSampleRate;
+        numSourceChannels = nextNumChannels;
+        sourceInMemory = nextSourceInMemory;
+        nextFile = juce::File();
+    }
+
+    if (nextTrackJob != NULL && loaderPool != nullptr && !loaderPool->contains(nextTrackJob.get()))
+        nextTrackJob.reset();
+
+    currentSampleRate = rate;
+    currentSong = loadedFile.getFullPathName();
+    currentPosition = 0.0;
+    ++playlistIndex;
+
+    clearMarkers();
+    clearTrackMarkers();
+
+    queueNextTrack();
+
+    if (onTrackChanged)
+        onTrackChanged();
 }
 
 
 
 void PlayerAudio::play() {
-    transportSource.start();
+    postCommand(DeckCommand::Type::Play);
 }
 
 void PlayerAudio::stop() {
     currentPosition = 0.0; 
-    transportSource.stop();
-    transportSource.setPosition(0.0);
+    postCommand(DeckCommand::Type::Stop);
 }
 
 void PlayerAudio::pause() {
-    currentPosition = transportSource.getCurrentPosition(); 
-    transportSource.stop();
-    transportSource.setPosition(currentPosition);
+    currentPosition = getPosition(); 
+    postCommand(DeckCommand::Type::Pause);
+}
+
+void PlayerAudio::schedulePlay(juce::int64 atSample) {
+    postCommand(DeckCommand::Type::Play, 0.0, atSample);
+}
+
+void PlayerAudio::schedulePause(juce::int64 atSample) {
+    postCommand(DeckCommand::Type::Pause, 0.0, atSample);
+}
+
+void PlayerAudio::scheduleSetPosition(double seconds, juce::int64 atSample) {
+    currentPosition = juce::jmax(0.0, seconds);
+    postCommand(DeckCommand::Type::Seek, seconds, atSample);
 }
 
 void PlayerAudio::goToEnd() {
-    transportSource.setPosition(transportSource.getLengthInSeconds());
+    currentPosition = getLength();
+    postCommand(DeckCommand::Type::SeekToEnd);
 }
 
 void PlayerAudio::goToStart() {
-    transportSource.setPosition(0.0);
+    seekTo(0.0);
 }
 
 void PlayerAudio::restart() {
-    transportSource.setPosition(0.0);
-    transportSource.start();
+    currentPosition = 0.0;
+    postCommand(DeckCommand::Type::Restart);
 }
 
 void PlayerAudio::loop() {
     isLooping = !isLooping;
-}
-
-void PlayerAudio::performLoop() {
-    if (isABLoopActive()) {
-        double len = getLength();
-        double markerATime = markerA * len;
-        double markerBTime = markerB * len;
-        double absPos = transportSource.getCurrentPosition();
-
-        if (absPos >= markerBTime || absPos < markerATime || transportSource.hasStreamFinished()) {
-            setPositionNormalized(markerA);
-            if (!transportSource.isPlaying())
-                transportSource.start();
-        }
-    }
-    else if (isLooping && transportSource.hasStreamFinished()) {
-        transportSource.setPosition(0.0);
-        transportSource.start();
-    }
+    updateLoopSource();
 }
 
 void PlayerAudio::setGain(float gain, bool mute)
@@ -180,16 +764,15 @@ void PlayerAudio::setGain(float gain, bool mute)
         isMuted = !isMuted;
 
         if (isMuted) {
-            lastGain = transportSource.getGain();
-            transportSource.setGain(0.0f);
+            postCommand(DeckCommand::Type::SetGain, 0.0);
         }
         else {
-            transportSource.setGain(lastGain);
+            postCommand(DeckCommand::Type::SetGain, lastGain);
         }
     }
     else {
         if (!isMuted) {
-            transportSource.setGain(gain);
+            postCommand(DeckCommand::Type::SetGain, gain);
             lastGain = gain;
 
         }
@@ -203,102 +786,193 @@ void PlayerAudio::setGain(float gain)
 }
 
 void PlayerAudio::setPosition(double pos) {
-    transportSource.setPosition(pos);
+    seekTo(pos);
 }
 
 double PlayerAudio::getPosition() { 
-    if (transportSource.isPlaying())
+    const auto& state = publishedState.read();
+    if (isStateCurrent(state))
     {
-        currentPosition = transportSource.getCurrentPosition();
+        currentPosition = state.positionSeconds;
     }
     return currentPosition;
 }
 
 double PlayerAudio::getLength() const {
-    return transportSource.getLengthInSeconds();
+    return getLength(publishedState.read());
+}
+
+double PlayerAudio::getLength(const DeckState& state) const {
+    if (state.epoch == commandEpoch.load() && state.lengthSeconds > 0.0)
+        return state.lengthSeconds;
+
+    // nothing published for this track yet
+    return currentSampleRate > 0.0 ? getLengthInSamples() / currentSampleRate : 0.0;
 }
 
 double PlayerAudio::getPositionNormalized() const {
-    double len = transportSource.getLengthInSeconds();
+    // one snapshot for both, so length and position come from the same block
+    const auto& state = publishedState.read();
+    double len = getLength(state);
     if (len <= 0.0)
         return 0.0;
-    if (transportSource.isPlaying())
+    if (isStateCurrent(state))
     {
-        return transportSource.getCurrentPosition() / len;
+        return state.positionSeconds / len;
     }
 
     return currentPosition / len;
 }
 
 void PlayerAudio::setPositionNormalized(double normalizedPos) {
-    double len = transportSource.getLengthInSeconds();
+    double len = getLength();
     if (len <= 0.0)
         return;
-    transportSource.setPosition(normalizedPos * len);
-    currentPosition = normalizedPos * len;
+    currentPosition = juce::jlimit(0.0, 1.0, normalizedPos) * len;
+    postCommand(DeckCommand::Type::SeekNormalized, normalizedPos);
+}
+
+void PlayerAudio::setPositionInSamples(juce::int64 sample) {
+    sample = juce::jlimit((juce::int64)0, getLengthInSamples(), sample);
+    currentPosition = currentSampleRate > 0.0 ? sample / currentSampleRate : 0.0;
+    postCommand(DeckCommand::Type::SeekSample, (double)sample);
+}
+
+void PlayerAudio::beginScrub(double normalizedPos) {
+    scrubTarget = juce::jlimit(0.0, 1.0, normalizedPos);
+    postCommand(DeckCommand::Type::ScrubStart);
+}
+
+// No command per drag event; the audio thread reads the latest position when a grain starts.
+void PlayerAudio::scrubTo(double normalizedPos) {
+    scrubTarget = juce::jlimit(0.0, 1.0, normalizedPos);
+    currentPosition = scrubTarget.load() * getLength();
+}
+
+void PlayerAudio::endScrub(double normalizedPos) {
+    scrubTo(normalizedPos);
+    postCommand(DeckCommand::Type::ScrubEnd, normalizedPos);
 }
 
 void PlayerAudio::setSpeed(double speed)
 {
+    // tempo only; the stretcher keeps pitch and never interrupts the transport
     currentSpeed = speed;
-    if (readerSource != NULL && currentSampleRate > 0.0) {
-        bool playing = transportSource.isPlaying();
-        double normalizedPos = getPositionNormalized();
+    postCommand(DeckCommand::Type::SetSpeed, speed);
+}
 
-        transportSource.stop();
-        transportSource.setSource(NULL);
+void PlayerAudio::setEqGain(DeckEqualizer::Band band, float gainDb)
+{
+    static constexpr DeckCommand::Type types[] = { DeckCommand::Type::SetEqLow, DeckCommand::Type::SetEqMid,
+                                                   DeckCommand::Type::SetEqHigh };
+    eqGainDb[(int)band] = juce::jlimit(DeckEqualizer::killDb, DeckEqualizer::maxBoostDb, gainDb);
+    postCommand(types[(int)band], eqGainDb[(int)band]);
+}
 
-        double newRate = currentSampleRate * speed;
-        transportSource.setSource(readerSource.get(), 0, NULL, newRate);
+void PlayerAudio::setFilter(float position)
+{
+    filterPosition = juce::jlimit(-1.0f, 1.0f, position);
+    postCommand(DeckCommand::Type::SetFilter, filterPosition);
+}
 
-        setPositionNormalized(normalizedPos);
-        if (playing)
-            transportSource.start();
-    }
+void PlayerAudio::setReverse(bool shouldReverse)
+{
+    reverse = shouldReverse;
+    postCommand(DeckCommand::Type::SetReverse, shouldReverse ? 1.0 : 0.0);
+}
+
+void PlayerAudio::setEffectEnabled(DeckEffectChain::Effect effect, bool enabled)
+{
+    effectLayout.enabled[(size_t)effect] = enabled;
+    postCommand(DeckCommand::Type::SetEffectLayout, effectLayout.pack());
+}
+
+void PlayerAudio::moveEffect(DeckEffectChain::Effect effect, int slot)
+{
+    effectLayout.moveTo(effect, slot);
+    postCommand(DeckCommand::Type::SetEffectLayout, effectLayout.pack());
+}
+
+void PlayerAudio::setEffectParameter(DeckEffectChain::Effect effect, DeckEffectChain::Parameter parameter, float value)
+{
+    postCommand(DeckCommand::Type::SetEffectParameter, value, -1,
+        (int)effect * DeckEffectChain::maxParameters + (int)parameter);
+}
+
+void PlayerAudio::setStretchQuality(TimeStretchAudioSource::Quality quality)
+{
+    timeStretch.setQuality(quality);
+}
+
+void PlayerAudio::setResamplerQuality(PolyphaseResamplingAudioSource::Quality quality)
+{
+    resampler.setQuality(quality);
+}
+
+void PlayerAudio::seekTo(double seconds)
+{
+    currentPosition = juce::jmax(0.0, seconds);
+    postCommand(DeckCommand::Type::Seek, seconds);
 }
 
 void PlayerAudio::setMarkerA() {
-    markerA = juce::jlimit(0.0, 1.0, getPositionNormalized());
+    markerA = juce::jlimit((juce::int64)0, getLengthInSamples(), getPositionInSamples());
     if (markerB >= 0 && markerA >= markerB)
-        markerB = -1.0;
+        markerB = -1;
+    updateLoopSource();
 }
 
 void PlayerAudio::setMarkerB() {
-    markerB = juce::jlimit(0.0, 1.0, getPositionNormalized());
+    markerB = juce::jlimit((juce::int64)0, getLengthInSamples(), getPositionInSamples());
     if (markerA >= 0 && markerB <= markerA)
-        markerA = -1.0;
+        markerA = -1;
+    updateLoopSource();
 }
 
 void PlayerAudio::clearMarkers() {
-    markerA = -1.0;
-    markerB = -1.0;
+    markerA = -1;
+    markerB = -1;
     isABLoopEnabled = false;
+    updateLoopSource();
 }
 
 void PlayerAudio::toggleABLoop() {
     isABLoopEnabled = !isABLoopEnabled;
     if (isABLoopEnabled && (markerA < 0 || markerB < 0 || markerB <= markerA))
         isABLoopEnabled = false;
+    updateLoopSource();
 }
 
 void PlayerAudio::setMarkerAFromNormalized(double normalizedPos) {
-    markerA = juce::jlimit(0.0, 1.0, normalizedPos);
-    if (markerB >= 0 && markerA >= markerB)
-        markerB = -1.0;
+    setMarkerAAtSample((juce::int64)(juce::jlimit(0.0, 1.0, normalizedPos) * (double)getLengthInSamples()));
 }
 
 void PlayerAudio::setMarkerBFromNormalized(double normalizedPos) {
-    markerB = juce::jlimit(0.0, 1.0, normalizedPos);
+    setMarkerBAtSample((juce::int64)(juce::jlimit(0.0, 1.0, normalizedPos) * (double)getLengthInSamples()));
+}
+
+void PlayerAudio::setMarkerAAtSample(juce::int64 sample) {
+    markerA = juce::jlimit((juce::int64)0, getLengthInSamples(), sample);
+    if (markerB >= 0 && markerA >= markerB)
+        markerB = -1;
+    updateLoopSource();
+}
+
+void PlayerAudio::setMarkerBAtSample(juce::int64 sample) {
+    markerB = juce::jlimit((juce::int64)0, getLengthInSamples(), sample);
     if (markerA >= 0 && markerB <= markerA)
-        markerA = -1.0;
-    }
+        markerA = -1;
+    updateLoopSource();
+}
 
 double PlayerAudio::getMarkerA() const {
-    return markerA;
+    juce::int64 len = getLengthInSamples();
+    return (markerA >= 0 && len > 0) ? markerA / (double)len : -1.0;
 }
 
 double PlayerAudio::getMarkerB() const {
-    return markerB;
+    juce::int64 len = getLengthInSamples();
+    return (markerB >= 0 && len > 0) ? markerB / (double)len : -1.0;
 }
 
 bool PlayerAudio::isABLoopActive() const {
@@ -306,75 +980,135 @@ bool PlayerAudio::isABLoopActive() const {
 }
 
 double PlayerAudio::getMarkerATime() const {
-    return (markerA >= 0) ? markerA * getLength() : -1.0;
+    return (markerA >= 0 && currentSampleRate > 0.0) ? markerA / currentSampleRate : -1.0;
 }
 
 double PlayerAudio::getMarkerBTime() const {
-    return (markerB >= 0) ? markerB * getLength() : -1.0;
+    return (markerB >= 0 && currentSampleRate > 0.0) ? markerB / currentSampleRate : -1.0;
+}
+
+void PlayerAudio::setLoopCrossfade(double seconds) {
+    loopCrossfadeSeconds = juce::jmax(0.0, seconds);
+    if (loopSource != NULL)
+        loopSource->setCrossfadeLength((int)(loopCrossfadeSeconds * currentSampleRate));
+}
+
+juce::int64 PlayerAudio::getLengthInSamples() const {
+    return readerSource != NULL ? readerSource->getTotalLength() : 0;
+}
+
+// Straight from the audio thread's transport when it is current, so no rounding through seconds.
+juce::int64 PlayerAudio::getPositionInSamples() const {
+    const auto& state = publishedState.read();
+    if (isStateCurrent(state))
+        return state.positionSamples;
+
+    return currentSampleRate > 0.0 ? (juce::int64)std::llround(currentPosition * currentSampleRate) : 0;
+}
+
+// A-B takes priority over whole-track looping; the loop source wraps on the exact sample.
+void PlayerAudio::updateLoopSource() {
+    if (loopSource == NULL)
+        return;
+
+    const bool abActive = isABLoopActive();
+    const bool hasAB = markerA >= 0 && markerB > markerA;
+
+    // an A-B range is handed over even while disabled so its head gets captured on the first pass
+    if (hasAB && (abActive || !isLooping)) {
+        loopSource->setLoopRange(markerA, markerB);
+        reverser.setLoopRange(markerA, markerB);
+    }
+    else {
+        loopSource->setLoopRange(0, getLengthInSamples());
+        reverser.setLoopRange(0, getLengthInSamples());
+    }
+
+    loopSource->setLoopEnabled(abActive || isLooping);
+    reverser.setLoopEnabled(abActive || isLooping);
 }
 
 void PlayerAudio::addTrackMarker() {
-    trackMarkers.add(juce::jlimit(0.0, 1.0, getPositionNormalized()));
-    trackMarkers.sort();
+    addTrackMarkerAtSample(getPositionInSamples());
 }
 
 void PlayerAudio::removeTrackMarker(int index) {
-    if (index >= 0 && index < trackMarkers.size())
+    if (index >= 0 && index < trackMarkers.size()) {
         trackMarkers.remove(index);
+        updateHotCues();
+    }
 }
 
 void PlayerAudio::jumpToMarker(int index) {
     if (index >= 0 && index < trackMarkers.size()) {
-        double normalizedPos = trackMarkers[index];
-        setPositionNormalized(normalizedPos);
-        if (!transportSource.isPlaying())
-            transportSource.start();
+        const juce::int64 sample = trackMarkers[index];
+        currentPosition = currentSampleRate > 0.0 ? sample / currentSampleRate : 0.0;
+        postCommand(DeckCommand::Type::JumpAndPlay, (double)sample);
     }
 }
 
 double PlayerAudio::getMarkerTime(int index) const {
-    double len = getLength();
-    if (len <= 0.0) return -1.0;
-    return (index >= 0 && index < trackMarkers.size()) ? trackMarkers[index] * len : -1.0;
+    if (currentSampleRate <= 0.0) return -1.0;
+    return (index >= 0 && index < trackMarkers.size()) ? trackMarkers[index] / currentSampleRate : -1.0;
+}
+
+juce::int64 PlayerAudio::getMarkerSample(int index) const {
+    return (index >= 0 && index < trackMarkers.size()) ? trackMarkers[index] : -1;
 }
 
 void PlayerAudio::addTrackMarkerFromNormalized(double normalizedPos) {
-    trackMarkers.add(juce::jlimit(0.0, 1.0, normalizedPos));
+    addTrackMarkerAtSample((juce::int64)(juce::jlimit(0.0, 1.0, normalizedPos) * (double)getLengthInSamples()));
+}
+
+void PlayerAudio::addTrackMarkerAtSample(juce::int64 sample) {
+    trackMarkers.add(juce::jlimit((juce::int64)0, getLengthInSamples(), sample));
     trackMarkers.sort();
+    updateHotCues();
 }
 
 void PlayerAudio::clearTrackMarkers() {
     trackMarkers.clear();
+    updateHotCues();
+}
+
+// Streaming tracks only; memory-mapped and cached ones have no decoder to wait for. Markers
+// are the exact samples JumpAndPlay seeks to, so a jump lands on the first sample of its window.
+void PlayerAudio::updateHotCues() {
+    if (readAheadSource == NULL)
+        return;
+
+    readAheadSource->setCuePoints(trackMarkers, (int)(hotCueSeconds * currentSampleRate));
 }
 
 
 void PlayerAudio::tenSec(bool forward)
 {
-    double newPosition = transportSource.getCurrentPosition();
+    currentPosition = juce::jlimit(0.0, getLength(), getPosition() + (forward ? 10.0 : -10.0));
 
-    if (forward)
-        newPosition += 10.0;
-    else {
-        newPosition -= 10.0;
-    }
-
-    if (newPosition < 0)
-        newPosition = 0;
-    if (newPosition > transportSource.getLengthInSeconds())
-        newPosition = transportSource.getLengthInSeconds();
-
-    transportSource.setPosition(newPosition);
+    // relative, so it lands correctly even if the deck moves before the audio thread applies it
+    postCommand(DeckCommand::Type::SeekRelative, forward ? 10.0 : -10.0);
 }
 
 void PlayerAudio::resetToDefault()
 {
-    transportSource.stop();
+    ++commandEpoch;
     transportSource.setSource(nullptr);
+    cancelNextTrack();
+    playlistIndex = -1;
+    playlist.clear();
 
     currentSong = "";
     currentPosition = 0.0;
     currentVolume = 1.0f;
     currentSpeed = 1.0;
+    postCommand(DeckCommand::Type::SetSpeed, 1.0);
+    setEqGain(DeckEqualizer::Band::Low, 0.0f);
+    setEqGain(DeckEqualizer::Band::Mid, 0.0f);
+    setEqGain(DeckEqualizer::Band::High, 0.0f);
+    setFilter(0.0f);
+    effectLayout = DeckEffectChain::Layout();
+    postCommand(DeckCommand::Type::SetEffectLayout, effectLayout.pack());
+    setReverse(false);
     loadedFile = juce::File();
 
     isLooping = false;
@@ -385,5 +1119,135 @@ void PlayerAudio::resetToDefault()
     clearTrackMarkers();
     isABLoopEnabled = false;
 
+    queueSource.setCurrent(nullptr);
+    loopSource.reset();
+    readAheadSource.reset();
     readerSource.reset();
+}
+
+// Plays WAV/AIFF from a memory mapping and serves other tracks from the decoded-track cache
+// when they are there. Anything else gets a streaming reader, and the cache is asked to
+// decode the file in the background for next time. Files over maxMappedBytes are not
+// mapped and tracks over maxDecodedBytes are not cached, so long recordings only ever hold
+// the read-ahead ring in memory. Called on the message thread and on the loader pool.
+std::unique_ptr<juce::PositionableAudioSource> PlayerAudio::openSource(const juce::File& file,
+    double& sampleRate, int& numChannels, bool& inMemory)
+{
+    // a mapping costs what the file takes on disk
+    if (file.getSize() <= maxMappedBytes) {
+        if (auto mapped = MappedTrackAudioSource::createFor(formatManager, file, readAheadThread)) {
+            sampleRate = mapped->getSampleRate();
+            numChannels = mapped->getNumChannels();
+            inMemory = true;
+            return mapped;
+        }
+    }
+
+    if (trackCache != nullptr) {
+        if (auto track = trackCache->find(file)) {
+            sampleRate = track->sampleRate;
+            numChannels = track->samples.getNumChannels();
+            inMemory = true;
+            return std::make_unique<DecodedTrackAudioSource>(std::move(track));
+        }
+    }
+
+    // MP3s are indexed on the loader pool the first time, for exact seeks and length after that
+    auto reader = Mp3FrameIndex::createReader(formatManager, file, loaderPool);
+    if (reader == NULL)
+        return nullptr;
+
+    sampleRate = reader->sampleRate;
+    numChannels = (int)reader->numChannels;
+    inMemory = false;
+
+    // the decoded size decides, so a long compressed recording streams too
+    const juce::int64 decodedBytes = reader->lengthInSamples * juce::jlimit(1, 2, numChannels) * (juce::int64)sizeof(float);
+    if (trackCache != nullptr && decodedBytes <= maxDecodedBytes)
+        trackCache->requestDecode(file);
+
+    return std::make_unique<juce::AudioFormatReaderSource>(reader.release(), true);
+}
+
+// Builds reader -> read-ahead -> loop -> queue -> reverser -> transport. The read-ahead stage is only used when a
+// background thread is available, so the audio callback only ever copies decoded samples.
+void PlayerAudio::attachSource()
+{
+    if (readerSource == NULL)
+        return;
+
+    queueSource.setCurrent(nullptr);
+    loopSource.reset();
+
+    juce::PositionableAudioSource* source = readerSource.get();
+
+    if (sourceInMemory) {
+        readAheadSource.reset();
+    }
+    else if (readAheadThread != nullptr) {
+        if (readAheadSource == NULL || readAheadSource->getBufferSize() < readAheadSamples)
+            readAheadSource = std::make_unique<ReadAheadAudioSource>(readerSource.get(),
+                *readAheadThread,
+                readAheadSamples,
+                juce::jmax(2, numSourceChannels));
+        readAheadSource->setReverseFlag(&reverser.getReversedFlag());
+        source = readAheadSource.get();
+    }
+
+    loopSource = std::make_unique<LoopingAudioSource>(source, 2);
+    loopSource->setReadAheadSource(readAheadSource.get());
+    loopSource->setCrossfadeLength((int)(loopCrossfadeSeconds * currentSampleRate));
+    updateLoopSource();
+    updateHotCues();
+
+    queueSource.setCurrent(loopSource.get());
+    // a backward chunk must stay within what the read-ahead keeps above the play position
+    reverser.setMaxChunkSize(readAheadSource != NULL ? readAheadSource->getReverseReadLimit()
+                                                     : ReversibleAudioSource::cacheSize);
+
+    // no rate correction in the transport; the deck's own resampler sits behind it
+    playbackSampleRate = currentSampleRate;
+    resampler.setSourceSampleRate(currentSampleRate);
+    transportSource.setSource(&reverser);
+}
+
+void PlayerAudio::setReadAheadSize(int numSamples)
+{
+    numSamples = juce::jmax(1024, numSamples);
+    if (numSamples == readAheadSamples)
+        return;
+
+    readAheadSamples = numSamples;
+
+    if (readAheadSource != NULL) {
+        bool playing = isPlaying();
+        const juce::int64 position = getPositionInSamples();
+
+        transportSource.setSource(NULL);
+        queueSource.setCurrent(nullptr);
+        loopSource.reset();
+        readAheadSource.reset();
+
+        attachSource();
+
+        setPositionInSamples(position);
+        if (playing)
+            postCommand(DeckCommand::Type::Play);
+    }
+}
+
+double PlayerAudio::getReadAheadFillLevel() const
+{
+    return readAheadSource != NULL ? readAheadSource->getFillLevel() : 0.0;
+}
+
+int PlayerAudio::getUnderrunCount() const
+{
+    return readAheadSource != NULL ? readAheadSource->getUnderrunCount() : 0;
+}
+
+void PlayerAudio::resetUnderrunCount()
+{
+    if (readAheadSource != NULL)
+        readAheadSource->resetUnderrunCount();
 }
\ No newline at end of file
@@ -1,11 +1,120 @@
 #pragma once
 #include <JuceHeader.h>
+#include <array>
+#include "ReadAheadAudioSource.h"
+#include "LoopingAudioSource.h"
+#include "TimeStretchAudioSource.h"
+#include "PolyphaseResamplingAudioSource.h"
+#include "TrackQueueAudioSource.h"
+#include "ReversibleAudioSource.h"
+#include "DecodedTrackCache.h"
+#include "DeckCommandQueue.h"
+#include "DeckStateSnapshot.h"
+#include "GainRamp.h"
+#include "DeckEqualizer.h"
+#include "DeckEffectChain.h"
+#include "MasterClock.h"
 
-class PlayerAudio {
+class PlayerAudio : private juce::AsyncUpdater {
 private:
     juce::AudioFormatManager formatManager;
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+    std::unique_ptr<juce::PositionableAudioSource> readerSource;
+    std::unique_ptr<ReadAheadAudioSource> readAheadSource;
+    std::unique_ptr<LoopingAudioSource> loopSource;
+
+    // the next playlist entry, opened and primed on the loader pool before the current one ends
+    std::unique_ptr<juce::PositionableAudioSource> nextReaderSource;
+    std::unique_ptr<ReadAheadAudioSource> nextReadAheadSource;
+    std::unique_ptr<LoopingAudioSource> nextLoopSource;
+    juce::File nextFile;
+    double nextSampleRate = 0.0;
+    int nextNumChannels = 2;
+    bool nextSourceInMemory = false;
+    juce::CriticalSection nextTrackLock;
+
+    class NextTrackJob;
+    std::unique_ptr<NextTrackJob> nextTrackJob;
+    juce::ThreadPool* loaderPool = nullptr;
+    int playlistIndex = -1;
+    int preparedBlockSize = 0;
+    double preparedSampleRate = 0.0;
+
+    TrackQueueAudioSource queueSource;
+    ReversibleAudioSource reverser{ &queueSource };
     juce::AudioTransportSource transportSource;
+    PolyphaseResamplingAudioSource resampler{ &transportSource };
+    TimeStretchAudioSource timeStretch{ &resampler };
+
+    // volume and mute, glided per sample on the audio thread
+    GainRamp deckGain;
+
+    // tone and filter, after the stretcher so it runs at the device rate
+    DeckEqualizer equalizer;
+    float eqGainDb[3] = { 0.0f, 0.0f, 0.0f };
+    float filterPosition = 0.0f;
+    bool reverse = false;
+
+    // inserts after the EQ; the message thread keeps its own copy of the layout
+    DeckEffectChain effectChain;
+    DeckEffectChain::Layout effectLayout;
+
+    // rate of the track the transport is reading; switched by the audio thread at a gapless splice
+    std::atomic<double> playbackSampleRate{ 0.0 };
+    std::atomic<double> queuedSampleRate{ 0.0 };
+
+    juce::TimeSliceThread* readAheadThread = nullptr;
+    int readAheadSamples = 65536;
+    int numSourceChannels = 2;
+
+    // fully decoded tracks shared by every deck; cached and memory-mapped tracks need no read-ahead stage
+    DecodedTrackCache* trackCache = nullptr;
+    bool sourceInMemory = false;
+
+    // GUI -> audio thread; everything below the queue is owned by the audio thread
+    DeckCommandQueue commandQueue;
+    std::atomic<int> commandEpoch{ 0 };
+    bool deckPlaying = false;
+    bool stopRequested = false;
+    bool seekAfterStop = false;
+    juce::uint32 lastDrainedCommand = 0;
+
+    // commands waiting for their master clock sample, in posting order
+    static constexpr int maxScheduledCommands = 32;
+    std::array<DeckCommand, maxScheduledCommands> scheduledCommands;
+    int numScheduledCommands = 0;
+    int scheduledEpoch = 0;
+    const MasterClock* masterClock = nullptr;
+    int publishedEpoch = -1;
+
+    // position-slider scrubbing: the GUI only stores the latest drag position, and the audio
+    // thread seeks to it when a grain starts, so a fast drag never piles up seeks
+    static constexpr double scrubGrainSeconds = 0.04;
+    std::atomic<double> scrubTarget{ 0.0 };
+    bool scrubbing = false;
+    bool scrubReleased = false;
+    juce::int64 scrubFinal = 0;
+    juce::int64 grainStart = -1;
+    int grainPosition = 0;
+    int grainLength = 0;
+    juce::HeapBlock<float> grainWindow;
+
+    // audio thread -> GUI; the message thread never asks the transport directly
+    DeckStateSnapshot publishedState;
+    juce::uint32 postedCommands = 0;
+    juce::uint32 lastSeekCommand = 0;
+
+    void postCommand(DeckCommand::Type type, double value = 0.0, juce::int64 atSample = -1, int index = 0);
+    void applyCommand(const DeckCommand& command);
+    void scheduleCommand(const DeckCommand& command);
+    juce::uint32 getAppliedCommand() const;
+    int findDueCommand(juce::int64 blockEnd) const;
+    void renderSegment(const juce::AudioSourceChannelInfo& block, int offset, int numSamples);
+    void renderScrub(const juce::AudioSourceChannelInfo& segment);
+    void publishState(int epoch);
+    void seekToSample(juce::int64 sample);
+    bool isStateCurrent(const DeckState& state) const;
+    // the length from this snapshot, or from the reader while nothing is published
+    double getLength(const DeckState& state) const;
 
  
     double lastKnownPosition = 0.0;
@@ -24,11 +133,36 @@ private:
 
     double currentSampleRate = 0.0;
 
+    // files above this are streamed through the read-ahead ring instead of being memory
+    // mapped, so a multi-hour recording costs the same memory as a three-minute one
+    static constexpr juce::int64 maxMappedBytes = (juce::int64)1 << 30;
+    // tracks that decode to more float PCM than this always stream and are never handed to
+    // the decoded-track cache, however small the file is on disk
+    static constexpr juce::int64 maxDecodedBytes = (juce::int64)512 << 20;
+
+    std::unique_ptr<juce::PositionableAudioSource> openSource(const juce::File& file,
+        double& sampleRate, int& numChannels, bool& inMemory);
+    void attachSource();
+    void seekTo(double seconds);
+
+    void queueNextTrack();
+    void prepareNextTrack(const juce::File& file, juce::ThreadPoolJob& job);
+    void cancelNextTrack();
+    bool withdrawNextTrack();
+    void handleAsyncUpdate() override;
+
     bool isABLoopEnabled = false;
-    double markerA = -1.0;
-    double markerB = -1.0;
+    juce::int64 markerA = -1;
+    juce::int64 markerB = -1;
+    double loopCrossfadeSeconds = 0.0;
+
+    void updateLoopSource();
 
-    juce::Array<double> trackMarkers;
+    // in samples of the loaded track, sorted
+    juce::Array<juce::int64> trackMarkers;
+    // decoded at each marker by the read-ahead stage, so jumpToMarker() starts at once
+    static constexpr double hotCueSeconds = 0.4;
+    void updateHotCues();
 
     juce::File loadedFile;
 
@@ -38,6 +172,9 @@ public:
     ~PlayerAudio();
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
     void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
+    // audio thread; false while the deck is stopped with nothing to apply or publish, so
+    // the mixer can skip it and its output is silence
+    bool needsRender() const;
     void releaseResources();
 
     bool loadFile(const juce::File& file);
@@ -47,6 +184,14 @@ public:
     void restart();
     void stop();
     void pause();
+
+    // sample-accurate versions against the shared master clock; the same sample on two
+    // decks starts them in phase
+    void setMasterClock(const MasterClock* clock) { masterClock = clock; }
+    void schedulePlay(juce::int64 atSample);
+    void schedulePause(juce::int64 atSample);
+    void scheduleSetPosition(double seconds, juce::int64 atSample);
+
     void goToEnd();
     void goToStart();
     void loop();
@@ -56,18 +201,61 @@ public:
     double getPosition() ;
     double getLength() const;
     void setPositionNormalized(double normalizedPos);
+    // exact, in samples of the loaded track
+    void setPositionInSamples(juce::int64 sample);
+    juce::int64 getPositionInSamples() const;
+    juce::int64 getLengthInSamples() const;
+    // while the position slider is dragged: the deck plays short grains at the drag
+    // position, and endScrub() leaves it at the final one, playing or not as before
+    void beginScrub(double normalizedPos);
+    void scrubTo(double normalizedPos);
+    void endScrub(double normalizedPos);
     double getPositionNormalized() const;
     bool isLoopingEnabled() const { return isLooping; }
-    void performLoop();
     void setSpeed(double speed);
     double getSpeed() const { return currentSpeed; }
+    void setStretchQuality(TimeStretchAudioSource::Quality quality);
+    TimeStretchAudioSource::Quality getStretchQuality() const { return timeStretch.getQuality(); }
+
+    // DeckEqualizer::killDb to DeckEqualizer::maxBoostDb; the audio thread glides to it
+    void setEqGain(DeckEqualizer::Band band, float gainDb);
+    float getEqGain(DeckEqualizer::Band band) const { return eqGainDb[(int)band]; }
+    // -1 full low-pass, 0 off, +1 full high-pass
+    void setFilter(float position);
+    float getFilter() const { return filterPosition; }
+
+    // plays backwards from where the deck is; loops wrap end to start and the deck stops at 0
+    void setReverse(bool shouldReverse);
+    bool isReverse() const { return reverse; }
+
+    // insert effects; the audio thread picks up the new layout at its next block
+    void setEffectEnabled(DeckEffectChain::Effect effect, bool enabled);
+    bool isEffectEnabled(DeckEffectChain::Effect effect) const { return effectLayout.enabled[(size_t)effect]; }
+    void moveEffect(DeckEffectChain::Effect effect, int slot);
+    const DeckEffectChain::Layout& getEffectLayout() const { return effectLayout; }
+    void setEffectParameter(DeckEffectChain::Effect effect, DeckEffectChain::Parameter parameter, float value);
+    void setResamplerQuality(PolyphaseResamplingAudioSource::Quality quality);
+    PolyphaseResamplingAudioSource::Quality getResamplerQuality() const { return resampler.getQuality(); }
     void addtoPlaylist(const juce::Array<juce::File>& files);
     void loadFromPlaylist(int i);
+    // false for the entry playing now, which stays in the queue until the deck moves on
+    bool removeFromPlaylist(int i);
+    int getPlaylistIndex() const { return playlistIndex; }
+    void setLoaderPool(juce::ThreadPool* pool) { loaderPool = pool; }
+    void setTrackCache(DecodedTrackCache* cache) { trackCache = cache; }
+
+    // called on the message thread after the deck moved on to the next playlist entry
+    std::function<void()> onTrackChanged;
 
     void setMarkerA();
     void setMarkerB();
     void setMarkerAFromNormalized(double normalizedPos);
     void setMarkerBFromNormalized(double normalizedPos);
+    void setMarkerAAtSample(juce::int64 sample);
+    void setMarkerBAtSample(juce::int64 sample);
+    // -1 when unset
+    juce::int64 getMarkerASample() const { return markerA; }
+    juce::int64 getMarkerBSample() const { return markerB; }
     void clearMarkers();
     void toggleABLoop();
     double getMarkerA() const;
@@ -75,13 +263,16 @@ public:
     bool isABLoopActive() const;
     double getMarkerATime() const;
     double getMarkerBTime() const;
+    void setLoopCrossfade(double seconds);
 
     void addTrackMarker();
     void addTrackMarkerFromNormalized(double normalizedPos);
+    void addTrackMarkerAtSample(juce::int64 sample);
     void removeTrackMarker(int index);
     void jumpToMarker(int index);
     int getMarkerCount() const { return trackMarkers.size(); }
     double getMarkerTime(int index) const;
+    juce::int64 getMarkerSample(int index) const;
     void clearTrackMarkers();
 
     float getCurrentVolume() const { return currentVolume; }
@@ -90,9 +281,16 @@ public:
     void tenSec(bool forward);
 
     bool getIsMuted() const { return isMuted; }
-    bool isPlaying() const { return transportSource.isPlaying(); }
+    bool isPlaying() const;
 
     void resetToDefault();
 
+    void setReadAheadThread(juce::TimeSliceThread* thread) { readAheadThread = thread; }
+    void setReadAheadSize(int numSamples);
+    int getReadAheadSize() const { return readAheadSamples; }
+    double getReadAheadFillLevel() const;
+    int getUnderrunCount() const;
+    void resetUnderrunCount();
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlayerAudio)
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 ﻿#include "PlayerGui.h"
+#include "Wave64AudioFormat.h"
 #include "BinaryData.h"
 
 
@@ -30,6 +31,18 @@ void ListRowComponent::paint(juce::Graphics& g) {
         g.drawText(markerText, 4, 0, markerColWidth, getHeight(), juce::Justification::centredLeft);
         g.drawText(timeText, markerColWidth + 12, 0, timeColWidth, getHeight(), juce::Justification::centredLeft);
     }
+    else if (rowMode == ListMode::PlaylistLeft || rowMode == ListMode::PlaylistRight) {
+        if (playerAudio == nullptr || index >= playerAudio->playlist.size())
+            return;
+
+        // the entry the deck is on now
+        if (index == playerAudio->getPlaylistIndex())
+            g.setColour(juce::Colours::orange);
+
+        int buttonArea = 110;
+        g.drawText(playerAudio->playlist[index].getFileName(), 4, 0, getWidth() - buttonArea - 8, getHeight(),
+            juce::Justification::centredLeft);
+    }
     else {
         if (playerGui == nullptr) return;
         if (index >= playerGui->playlist.size())
@@ -63,6 +76,7 @@ void ListRowComponent::paint(juce::Graphics& g) {
         else {
             juce::AudioFormatManager formatManager;
             formatManager.registerBasicFormats();
+            formatManager.registerFormat(new Wave64AudioFormat(), false);
             std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
             if (reader != nullptr) {
                 double duration = reader->lengthInSamples / reader->sampleRate;
@@ -89,6 +103,11 @@ int ListModel::getNumRows() {
     if (listMode == ListMode::Markers) {
         return playerAudio->getMarkerCount() + 1;
     }
+    else if (listMode == ListMode::PlaylistLeft || listMode == ListMode::PlaylistRight) {
+        if (playerAudio == nullptr)
+            return 1;
+        return playerAudio->playlist.size() + 1;
+    }
     else {
         if (playerGui == nullptr)
             return 1;
@@ -121,10 +140,14 @@ void ListModel::paintListBoxItem(int row, juce::Graphics& g, int width, int heig
             g.drawLine((float)(trackColWidth + 2), 0.0f, (float)(trackColWidth + 2), (float)height, 1.0f);
             g.drawLine((float)(trackColWidth + durationColWidth + 2), 0.0f, (float)(trackColWidth + durationColWidth + 2), (float)height, 1.0f);
         }
-        else {
+        else if (listMode == ListMode::Markers) {
             int markerColWidth = (int)(width * 0.5f);
             g.drawText("Markers", 4, 0, markerColWidth, height, juce::Justification::centredLeft);
         }
+        else {
+            g.drawText(listMode == ListMode::PlaylistLeft ? "Queue L" : "Queue R", 4, 0, width - 8, height,
+                juce::Justification::centredLeft);
+        }
     }
 }
 
@@ -150,6 +173,9 @@ juce::Component* ListModel::refreshComponentForRow(int rowNumber, bool isRowSele
     if (listMode == ListMode::Markers) {
         maxRows = playerAudio->getMarkerCount();
     }
+    else if (listMode == ListMode::PlaylistLeft || listMode == ListMode::PlaylistRight) {
+        maxRows = playerAudio != nullptr ? playerAudio->playlist.size() : 0;
+    }
     else {
         if (playerGui == nullptr)
             maxRows = 0;
@@ -170,6 +196,12 @@ juce::Component* ListModel::refreshComponentForRow(int rowNumber, bool isRowSele
             else
                 callback = [this]() { playerGui->updateMarkersListRight(); };
         }
+        else if (listMode == ListMode::PlaylistLeft) {
+            callback = [this]() { playerGui->updateQueueLeft(); };
+        }
+        else if (listMode == ListMode::PlaylistRight) {
+            callback = [this]() { playerGui->updateQueueRight(); };
+        }
         else {
             callback = [this]() { playerGui->updatePlaylist(); };
         }
@@ -199,22 +231,34 @@ void ListRowComponent::buttonClicked(juce::Button* button) {
             if (playerAudio != nullptr)
                 playerAudio->jumpToMarker(index);
         }
+        else if (playerAudio != nullptr && playerGui != nullptr) {
+            playerAudio->loadFromPlaylist(index);
+            if (rowMode == ListMode::PlaylistLeft)
+                playerGui->updateMetadataLeft();
+            else
+                playerGui->updateMetadataRight();
+            if (updateCallback)
+                updateCallback();
+        }
     }
     else if (button == &playLeftButton) {
         if (playerGui != nullptr && playerGui->playerAudioLeft != nullptr) {
             if (index >= 0 && index < playerGui->playlist.size()) {
-                juce::File file = playerGui->playlist[index];
-                playerGui->playerAudioLeft->loadFile(file);
+                // the deck keeps its own copy of the playlist as its queue and advances through it
+                playerGui->playerAudioLeft->playlist = playerGui->playlist;
+                playerGui->playerAudioLeft->loadFromPlaylist(index);
                 playerGui->updateMetadataLeft();
+                playerGui->updateQueueLeft();
             }
         }
     }
     else if (button == &playRightButton) {
         if (playerGui != nullptr && playerGui->playerAudioRight != nullptr) {
             if (index >= 0 && index < playerGui->playlist.size()) {
-                juce::File file = playerGui->playlist[index];
-                playerGui->playerAudioRight->loadFile(file);
+                playerGui->playerAudioRight->playlist = playerGui->playlist;
+                playerGui->playerAudioRight->loadFromPlaylist(index);
                 playerGui->updateMetadataRight();
+                playerGui->updateQueueRight();
             }
         }
     }
@@ -223,6 +267,10 @@ void ListRowComponent::buttonClicked(juce::Button* button) {
             if (playerAudio != nullptr)
                 playerAudio->removeTrackMarker(index);
         }
+        else if (rowMode == ListMode::PlaylistLeft || rowMode == ListMode::PlaylistRight) {
+            if (playerAudio != nullptr)
+                playerAudio->removeFromPlaylist(index);
+        }
         else {
             if (playerGui != nullptr)
                 playerGui->playlist.remove(index);
@@ -283,6 +331,8 @@ PlayerGui::PlayerGui() {
     addAndMakeVisible(PlaylistBox);
     addAndMakeVisible(markersListBoxLeft);
     addAndMakeVisible(markersListBoxRight);
+    addAndMakeVisible(queueListBoxLeft);
+    addAndMakeVisible(queueListBoxRight);
 
     resetLeftButton.addListener(this);
     resetRightButton.addListener(this);
@@ -324,7 +374,7 @@ PlayerGui::PlayerGui() {
     volumeSliderLeft.addListener(this);
     addAndMakeVisible(volumeSliderLeft);
 
-    positionSliderLeft.setRange(0.0, 1.0, 0.0001);
+    positionSliderLeft.setRange(0.0, 1.0);
     positionSliderLeft.setValue(0.0);
     positionSliderLeft.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
     positionSliderLeft.addListener(this);
@@ -378,17 +428,66 @@ PlayerGui::PlayerGui() {
     mixSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
     mixSlider.onValueChange = [this]()
         {
-            if (playerAudioLeft != nullptr && playerAudioRight != nullptr)
+            if (crossfader != nullptr)
+                crossfader->setPosition((float)mixSlider.getValue());
+        };
+
+    setupToneKnobs(toneKnobsLeft, true);
+    setupToneKnobs(toneKnobsRight, false);
+    setupEffectButtons(effectButtonsLeft, true);
+    setupEffectButtons(effectButtonsRight, false);
+
+    for (auto* btn : { &reverseButtonLeft, &reverseButtonRight })
+    {
+        btn->setTooltip("Play backwards");
+        btn->setColour(juce::TextButton::buttonOnColourId, juce::Colours::darkorange);
+        btn->onClick = [this, btn]()
             {
-                float mix = (float)mixSlider.getValue();
+                PlayerAudio* player = btn == &reverseButtonLeft ? playerAudioLeft : playerAudioRight;
+                if (player == nullptr)
+                    return;
+                player->setReverse(!player->isReverse());
+                btn->setToggleState(player->isReverse(), juce::dontSendNotification);
+            };
+        addAndMakeVisible(btn);
+    }
 
-                playerAudioLeft->setGain(1.0f - mix);
-                playerAudioRight->setGain(mix);
-            }
+    syncPlayButton.addListener(this);
+    addAndMakeVisible(syncPlayButton);
+
+    limiterButton.setToggleState(true, juce::dontSendNotification);
+    limiterButton.onClick = [this]()
+        {
+            if (onLimiterToggled != nullptr)
+                onLimiterToggled(limiterButton.getToggleState());
+        };
+    addAndMakeVisible(limiterButton);
+
+    trackCacheBox.addItem("Cache off", 1);
+    for (int i = 1; i < (int)std::size(trackCacheSizesMB); ++i)
+        trackCacheBox.addItem("Cache " + juce::String(trackCacheSizesMB[i]) + " MB", i + 1);
+    trackCacheBox.setSelectedId(1, juce::dontSendNotification);
+    trackCacheBox.setTooltip("Keep recently played tracks decoded in memory");
+    trackCacheBox.onChange = [this]()
+        {
+            if (onTrackCacheBudgetChanged != nullptr)
+                onTrackCacheBudgetChanged((juce::int64)trackCacheSizesMB[trackCacheBox.getSelectedId() - 1] * 1024 * 1024);
+        };
+    addAndMakeVisible(trackCacheBox);
+
+    addAndMakeVisible(crossfaderCurveBox);
+    crossfaderCurveBox.addItem("Linear", (int)Crossfader::Curve::Linear + 1);
+    crossfaderCurveBox.addItem("Constant power", (int)Crossfader::Curve::ConstantPower + 1);
+    crossfaderCurveBox.addItem("Cut", (int)Crossfader::Curve::Cut + 1);
+    crossfaderCurveBox.setSelectedId((int)Crossfader::Curve::ConstantPower + 1, juce::dontSendNotification);
+    crossfaderCurveBox.onChange = [this]()
+        {
+            if (crossfader != nullptr)
+                crossfader->setCurve((Crossfader::Curve)(crossfaderCurveBox.getSelectedId() - 1));
         };
 
 
-    positionSliderRight.setRange(0.0, 1.0, 0.0001);
+    positionSliderRight.setRange(0.0, 1.0);
     positionSliderRight.setValue(0.0);
     positionSliderRight.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
     positionSliderRight.addListener(this);
@@ -429,7 +528,7 @@ PlayerGui::PlayerGui() {
     setMarkerButtonRight.setVisible(true);
     addAndMakeVisible(&setMarkerButtonRight);
 
-    startTimer(100);
+    startTimer(activeTimerInterval);
 
 }
 
@@ -507,6 +606,8 @@ void PlayerGui::resized()
     goToEndButtonLeft.setBounds(rightButtonX, buttonY, buttonSize, buttonSize);
     rightButtonX += buttonSize + buttonSpacing;
     loopButtonLeft.setBounds(rightButtonX, buttonY, buttonSize, buttonSize);
+    rightButtonX += buttonSize + buttonSpacing;
+    reverseButtonLeft.setBounds(rightButtonX, buttonY, buttonSize, buttonSize);
     
     leftButtonX = playPauseXRight - (4 * (buttonSize + buttonSpacing));
     stopButtonRight.setBounds(leftButtonX, buttonY, buttonSize, buttonSize);
@@ -523,6 +624,8 @@ void PlayerGui::resized()
     goToEndButtonRight.setBounds(rightButtonX, buttonY, buttonSize, buttonSize);
     rightButtonX += buttonSize + buttonSpacing;
     loopButtonRight.setBounds(rightButtonX, buttonY, buttonSize, buttonSize);
+    rightButtonX += buttonSize + buttonSpacing;
+    reverseButtonRight.setBounds(rightButtonX, buttonY, buttonSize, buttonSize);
 
     int positionSliderY = buttonY + buttonSize + 20;
     positionSliderLeft.setBounds(leftStartX, positionSliderY, playerWidth, 25);
@@ -633,6 +736,24 @@ void PlayerGui::resized()
     int metadataXLeft = leftStartX + (playerWidth - metadataWidth) / 2;
     int metadataXRight = rightStartX + (playerWidth - metadataWidth) / 2;
     
+    // tone knobs in a row above the metadata
+    const int knobSize = 46;
+    const int knobSpacing = 12;
+    const int knobRowWidth = 4 * knobSize + 3 * knobSpacing;
+    for (int k = 0; k < 4; ++k) {
+        const int offsetX = (playerWidth - knobRowWidth) / 2 + k * (knobSize + knobSpacing);
+        toneKnobsLeft[(size_t)k].setBounds(leftStartX + offsetX, metadataTopY, knobSize, knobSize);
+        toneKnobsRight[(size_t)k].setBounds(rightStartX + offsetX, metadataTopY, knobSize, knobSize);
+    }
+    metadataTopY += knobSize + 4;
+    metadataNewHeight -= knobSize + 4;
+
+    const int effectRowHeight = 20;
+    layoutEffectButtons(effectButtonsLeft, playerAudioLeft, leftStartX + (playerWidth - knobRowWidth) / 2, metadataTopY, knobRowWidth);
+    layoutEffectButtons(effectButtonsRight, playerAudioRight, rightStartX + (playerWidth - knobRowWidth) / 2, metadataTopY, knobRowWidth);
+    metadataTopY += effectRowHeight + 4;
+    metadataNewHeight -= effectRowHeight + 4;
+
     fileInfoLabelLeft.setBounds(metadataXLeft, metadataTopY, metadataWidth, metadataNewHeight);
     fileInfoLabelRight.setBounds(metadataXRight, metadataTopY, metadataWidth, metadataNewHeight);
 
@@ -647,6 +768,10 @@ void PlayerGui::resized()
     int mixSliderSpacing = 10;
     int mixSliderY = folderButtonY - mixSliderSpacing - mixSliderHeight;
     mixSlider.setBounds(mixSliderX, mixSliderY, mixSliderWidth, mixSliderHeight);
+    crossfaderCurveBox.setBounds(mixSliderX + mixSliderWidth + mixSliderSpacing, mixSliderY + 4, 130, mixSliderHeight - 8);
+    syncPlayButton.setBounds(mixSliderX - mixSliderSpacing - 90, mixSliderY + 4, 90, mixSliderHeight - 8);
+    limiterButton.setBounds(mixSliderX + mixSliderWidth + 2 * mixSliderSpacing + 130, mixSliderY + 4, 80, mixSliderHeight - 8);
+    trackCacheBox.setBounds(mixSliderX + mixSliderWidth + 3 * mixSliderSpacing + 210, mixSliderY + 4, 130, mixSliderHeight - 8);
     
     loadFilesButton.toFront(false);
     setMarkerButtonLeft.toFront(false);
@@ -656,9 +781,15 @@ void PlayerGui::resized()
     int markersWidth = static_cast<int>(totalListWidth * 0.25f);
     int playlistWidth = totalListWidth - 2 * markersWidth;
 
-    markersListBoxLeft.setBounds(sideMargin, listY, markersWidth, listHeight);
+    // each deck's markers above its queue
+    int markersHeight = listHeight / 2;
+    int queueHeight = listHeight - markersHeight;
+
+    markersListBoxLeft.setBounds(sideMargin, listY, markersWidth, markersHeight);
+    queueListBoxLeft.setBounds(sideMargin, listY + markersHeight, markersWidth, queueHeight);
     PlaylistBox.setBounds(sideMargin + markersWidth, listY, playlistWidth, listHeight);
-    markersListBoxRight.setBounds(sideMargin + markersWidth + playlistWidth, listY, markersWidth, listHeight);
+    markersListBoxRight.setBounds(sideMargin + markersWidth + playlistWidth, listY, markersWidth, markersHeight);
+    queueListBoxRight.setBounds(sideMargin + markersWidth + playlistWidth, listY + markersHeight, markersWidth, queueHeight);
 
     resetLeftButton.toFront(false);
     resetRightButton.toFront(false);
@@ -667,11 +798,13 @@ void PlayerGui::resized()
 
 void PlayerGui::buttonClicked(juce::Button* button)
 {
+    wakeTimer();
+
     if (button == &loadButtonLeft) {
         fileChooser = std::make_unique<juce::FileChooser>(
             "Select an audio file...",
             juce::File{},
-            "*.wav;*.mp3");
+            "*.wav;*.w64;*.mp3");
 
         fileChooser->launchAsync(
             juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
@@ -688,7 +821,7 @@ void PlayerGui::buttonClicked(juce::Button* button)
         fileChooser = std::make_unique<juce::FileChooser>(
             "Select an audio file...",
             juce::File{},
-            "*.wav;*.mp3");
+            "*.wav;*.w64;*.mp3");
 
         fileChooser->launchAsync(
             juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
@@ -743,6 +876,9 @@ void PlayerGui::buttonClicked(juce::Button* button)
     else if (button == &loopButtonRight && playerAudioRight != nullptr) {
         playerAudioRight->loop();
     }
+    else if (button == &syncPlayButton && onSyncPlay != nullptr) {
+        onSyncPlay();
+    }
     else if (button == &muteButtonLeft && playerAudioLeft != nullptr) {
         playerAudioLeft->setGain(0.0f, true);
     }
@@ -785,7 +921,7 @@ void PlayerGui::buttonClicked(juce::Button* button)
         fileChooser = std::make_unique<juce::FileChooser>(
             "Select audio files...",
             juce::File{},
-            "*.wav;*.mp3");
+            "*.wav;*.w64;*.mp3");
 
         fileChooser->launchAsync(
             juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectMultipleItems,
@@ -793,7 +929,13 @@ void PlayerGui::buttonClicked(juce::Button* button)
             {
                 auto files = fc.getResults();
                 playlist.addArray(files);
+                for (auto* deck : { playerAudioLeft, playerAudioRight }) {
+                    if (deck != nullptr && deck->getPlaylistIndex() >= 0)
+                        deck->addtoPlaylist(files);
+                }
                 updatePlaylist();
+                updateQueueLeft();
+                updateQueueRight();
             });
     }
     else if (button == &forward10sButtonLeft && playerAudioLeft != nullptr) {
@@ -828,11 +970,11 @@ void PlayerGui::sliderValueChanged(juce::Slider* slider) {
     }
     else if (slider == &positionSliderLeft && playerAudioLeft != nullptr) {
         if (isDraggingSliderLeft)
-            playerAudioLeft->setPositionNormalized(positionSliderLeft.getValue());
+            playerAudioLeft->scrubTo(positionSliderLeft.getValue());
     }
     else if (slider == &positionSliderRight && playerAudioRight != nullptr) {
         if (isDraggingSliderRight)
-            playerAudioRight->setPositionNormalized(positionSliderRight.getValue());
+            playerAudioRight->scrubTo(positionSliderRight.getValue());
     }
     else if (slider == &speedSliderLeft && playerAudioLeft != nullptr) {
         playerAudioLeft->setSpeed(speedSliderLeft.getValue());
@@ -846,23 +988,34 @@ void PlayerGui::sliderValueChanged(juce::Slider* slider) {
 }
 
 void PlayerGui::sliderDragStarted(juce::Slider* slider) {
-    if (slider == &positionSliderLeft)
+    wakeTimer();
+    if (slider == &positionSliderLeft && playerAudioLeft != nullptr) {
         isDraggingSliderLeft = true;
-    else if (slider == &positionSliderRight)
+        playerAudioLeft->beginScrub(positionSliderLeft.getValue());
+    }
+    else if (slider == &positionSliderRight && playerAudioRight != nullptr) {
         isDraggingSliderRight = true;
+        playerAudioRight->beginScrub(positionSliderRight.getValue());
+    }
 }
 
 void PlayerGui::sliderDragEnded(juce::Slider* slider) {
-    if (slider == &positionSliderLeft)
+    if (slider == &positionSliderLeft && isDraggingSliderLeft) {
         isDraggingSliderLeft = false;
-    else if (slider == &positionSliderRight)
+        playerAudioLeft->endScrub(positionSliderLeft.getValue());
+    }
+    else if (slider == &positionSliderRight && isDraggingSliderRight) {
         isDraggingSliderRight = false;
+        playerAudioRight->endScrub(positionSliderRight.getValue());
+    }
 }
 
 void PlayerGui::timerCallback() {
     if (playerAudioLeft != nullptr && !isDraggingSliderLeft) {
-        positionSliderLeft.setValue(playerAudioLeft->getPositionNormalized());
-        progressValueLeft = playerAudioLeft->getPositionNormalized();
+        double normalized = playerAudioLeft->getPositionNormalized();
+        const bool moved = normalized != progressValueLeft;
+        positionSliderLeft.setValue(normalized);
+        progressValueLeft = normalized;
 
         double currentTime = playerAudioLeft->getPosition();
         double totalTime = playerAudioLeft->getLength();
@@ -892,12 +1045,15 @@ void PlayerGui::timerCallback() {
         playButtonLeft.setVisible(!isPlaying);
         pauseButtonLeft.setVisible(isPlaying);
 
-        markersListBoxLeft.repaint();
+        if (moved)
+            markersListBoxLeft.repaint();
     }
 
     if (playerAudioRight != nullptr && !isDraggingSliderRight) {
-        positionSliderRight.setValue(playerAudioRight->getPositionNormalized());
-        progressValueRight = playerAudioRight->getPositionNormalized();
+        double normalized = playerAudioRight->getPositionNormalized();
+        const bool moved = normalized != progressValueRight;
+        positionSliderRight.setValue(normalized);
+        progressValueRight = normalized;
 
         double currentTime = playerAudioRight->getPosition();
         double totalTime = playerAudioRight->getLength();
@@ -925,8 +1081,22 @@ void PlayerGui::timerCallback() {
         playButtonRight.setVisible(!isPlaying);
         pauseButtonRight.setVisible(isPlaying);
 
-        markersListBoxRight.repaint();
+        if (moved)
+            markersListBoxRight.repaint();
     }
+
+    const bool moving = isDraggingSliderLeft || isDraggingSliderRight
+        || (playerAudioLeft != nullptr && playerAudioLeft->isPlaying())
+        || (playerAudioRight != nullptr && playerAudioRight->isPlaying());
+    const int interval = moving ? activeTimerInterval : idleTimerInterval;
+    if (getTimerInterval() != interval)
+        startTimer(interval);
+}
+
+// a click may start a deck; refresh quickly until the next tick sees whether one did
+void PlayerGui::wakeTimer() {
+    if (getTimerInterval() != activeTimerInterval)
+        startTimer(activeTimerInterval);
 }
 
 juce::String PlayerGui::formatTime(double seconds) {
@@ -995,16 +1165,33 @@ void PlayerGui::restoreGUIFromSession()
                 
                 double len = player->getLength();
                 if (len > 0) {
-                    if (data.markerA >= 0.0) {
+                    // sample positions where the session has them; older sessions only stored seconds
+                    if (data.markerASample >= 0) {
+                        player->setMarkerAAtSample(data.markerASample);
+                    }
+                    else if (data.markerA >= 0.0) {
                         player->setMarkerAFromNormalized(data.markerA / len);
                     }
-                    if (data.markerB >= 0.0) {
+                    if (data.markerBSample >= 0) {
+                        player->setMarkerBAtSample(data.markerBSample);
+                    }
+                    else if (data.markerB >= 0.0) {
                         player->setMarkerBFromNormalized(data.markerB / len);
                     }
-                    for (const auto& markerTime : data.trackMarkers) {
-                        player->addTrackMarkerFromNormalized(markerTime / len);
+                    if (data.trackMarkerSamples.size() == data.trackMarkers.size()) {
+                        for (const auto& markerSample : data.trackMarkerSamples) {
+                            player->addTrackMarkerAtSample(markerSample);
+                        }
+                    }
+                    else {
+                        for (const auto& markerTime : data.trackMarkers) {
+                            player->addTrackMarkerFromNormalized(markerTime / len);
+                        }
                     }
-                    player->setPositionNormalized(data.position / len);
+                    if (data.positionSample >= 0)
+                        player->setPositionInSamples(data.positionSample);
+                    else
+                        player->setPositionNormalized(data.position / len);
                 }
                 if (data.abLoopActive && data.markerA >= 0.0 && data.markerB >= 0.0) {
                     player->toggleABLoop();
@@ -1013,6 +1200,11 @@ void PlayerGui::restoreGUIFromSession()
         }
     };
 
+    // before the decks load, so their tracks can go into the cache
+    for (int i = 0; i < (int)std::size(trackCacheSizesMB); ++i)
+        if (trackCacheSizesMB[i] == sessionTrackCacheMB)
+            trackCacheBox.setSelectedId(i + 1, juce::sendNotificationSync);
+
     restorePlayerState(playerAudioLeft, sessionDataLeft);
     restorePlayerState(playerAudioRight, sessionDataRight);
 
@@ -1029,10 +1221,111 @@ void PlayerGui::restoreGUIFromSession()
     updateMarkersListLeft();
     updateMarkersListRight();
     updatePlaylist();
+    updateQueueLeft();
+    updateQueueRight();
 
     repaint();
 }
 
+// Rotary low/mid/high kills and the filter sweep; double-click puts a knob back to neutral.
+void PlayerGui::setupToneKnobs(std::array<juce::Slider, 4>& knobs, bool left)
+{
+    static const char* const names[] = { "Low", "Mid", "High", "Filter" };
+
+    for (int k = 0; k < 4; ++k)
+    {
+        auto& knob = knobs[(size_t)k];
+        knob.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+        knob.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+        knob.setTooltip(names[k]);
+
+        if (k < 3)
+        {
+            knob.setRange(DeckEqualizer::killDb, DeckEqualizer::maxBoostDb, 0.1);
+            knob.setSkewFactorFromMidPoint(0.0);
+            knob.setTextValueSuffix(" dB");
+        }
+        else
+        {
+            knob.setRange(-1.0, 1.0, 0.01);
+        }
+        knob.setValue(0.0, juce::dontSendNotification);
+        knob.setDoubleClickReturnValue(true, 0.0);
+
+        knob.onValueChange = [this, &knob, k, left]()
+            {
+                PlayerAudio* player = left ? playerAudioLeft : playerAudioRight;
+                if (player == nullptr)
+                    return;
+                if (k < 3)
+                    player->setEqGain((DeckEqualizer::Band)k, (float)knob.getValue());
+                else
+                    player->setFilter((float)knob.getValue());
+            };
+        addAndMakeVisible(knob);
+    }
+}
+
+void PlayerGui::resetToneKnobs(std::array<juce::Slider, 4>& knobs)
+{
+    // the deck has already been reset; only the knobs need to follow
+    for (auto& knob : knobs)
+        knob.setValue(0.0, juce::dontSendNotification);
+}
+
+// Click switches an insert on or off; shift-click moves it one slot earlier in the chain.
+void PlayerGui::setupEffectButtons(std::array<juce::TextButton, DeckEffectChain::numEffects>& buttons, bool left)
+{
+    static const char* const names[] = { "Delay", "Reverb", "Filter", "Gate" };
+
+    for (int e = 0; e < DeckEffectChain::numEffects; ++e)
+    {
+        auto& button = buttons[(size_t)e];
+        button.setButtonText(names[e]);
+        button.setTooltip("Click to switch on or off, shift-click to move earlier in the chain");
+        button.setColour(juce::TextButton::buttonOnColourId, juce::Colours::darkorange);
+
+        button.onClick = [this, &buttons, e, left]()
+            {
+                PlayerAudio* player = left ? playerAudioLeft : playerAudioRight;
+                if (player == nullptr)
+                    return;
+
+                const auto effect = (DeckEffectChain::Effect)e;
+                if (juce::ModifierKeys::currentModifiers.isShiftDown())
+                {
+                    const auto& order = player->getEffectLayout().order;
+                    const int slot = (int)(std::find(order.begin(), order.end(), effect) - order.begin());
+                    player->moveEffect(effect, juce::jmax(0, slot - 1));
+                    resized();
+                }
+                else
+                {
+                    player->setEffectEnabled(effect, !player->isEffectEnabled(effect));
+                }
+                refreshEffectButtons(buttons, player);
+            };
+        addAndMakeVisible(button);
+    }
+}
+
+void PlayerGui::refreshEffectButtons(std::array<juce::TextButton, DeckEffectChain::numEffects>& buttons, const PlayerAudio* player)
+{
+    for (int e = 0; e < DeckEffectChain::numEffects; ++e)
+        buttons[(size_t)e].setToggleState(player != nullptr && player->isEffectEnabled((DeckEffectChain::Effect)e),
+            juce::dontSendNotification);
+}
+
+void PlayerGui::layoutEffectButtons(std::array<juce::TextButton, DeckEffectChain::numEffects>& buttons,
+    const PlayerAudio* player, int x, int y, int width)
+{
+    const auto order = player != nullptr ? player->getEffectLayout().order : DeckEffectChain::Layout().order;
+    const int buttonWidth = width / DeckEffectChain::numEffects;
+
+    for (int slot = 0; slot < DeckEffectChain::numEffects; ++slot)
+        buttons[(size_t)order[(size_t)slot]].setBounds(x + slot * buttonWidth, y, buttonWidth - 2, 20);
+}
+
 void PlayerGui::resetLeftPlayer()
 {
     if (playerAudioLeft != nullptr)
@@ -1042,6 +1335,10 @@ void PlayerGui::resetLeftPlayer()
         positionSliderLeft.setValue(0.0);
         volumeSliderLeft.setValue(1.0);
         speedSliderLeft.setValue(1.0);
+        resetToneKnobs(toneKnobsLeft);
+        refreshEffectButtons(effectButtonsLeft, playerAudioLeft);
+        reverseButtonLeft.setToggleState(false, juce::dontSendNotification);
+        resized();
 
         timeLabelLeft.setText("00:00:00 / 00:00:00", juce::dontSendNotification);
         fileInfoLabelLeft.setText("Currently playing:\nNo file loaded", juce::dontSendNotification);
@@ -1052,6 +1349,7 @@ void PlayerGui::resetLeftPlayer()
         pauseButtonLeft.setVisible(false);
 
         updateMarkersListLeft();
+        updateQueueLeft();
         
         if (sessionFilePath.existsAsFile() || sessionFilePath.getParentDirectory().exists()) {
             saveSession(sessionFilePath);
@@ -1068,6 +1366,10 @@ void PlayerGui::resetRightPlayer()
         positionSliderRight.setValue(0.0);
         volumeSliderRight.setValue(1.0);
         speedSliderRight.setValue(1.0);
+        resetToneKnobs(toneKnobsRight);
+        refreshEffectButtons(effectButtonsRight, playerAudioRight);
+        reverseButtonRight.setToggleState(false, juce::dontSendNotification);
+        resized();
 
         timeLabelRight.setText("00:00:00 / 00:00:00", juce::dontSendNotification);
         fileInfoLabelRight.setText("Currently playing:\nNo file loaded", juce::dontSendNotification);
@@ -1078,6 +1380,7 @@ void PlayerGui::resetRightPlayer()
         pauseButtonRight.setVisible(false);
 
         updateMarkersListRight();
+        updateQueueRight();
         
         if (sessionFilePath.existsAsFile() || sessionFilePath.getParentDirectory().exists()) {
             saveSession(sessionFilePath);
@@ -1110,22 +1413,27 @@ void PlayerGui::saveSession(const juce::File& sessionFile)
     auto savePlayerState = [&stream](PlayerAudio* player, const juce::String& prefix) {
         stream->writeString(prefix + "_CURRENT_SONG:" + player->getCurrentSongPath() + "\n");
         stream->writeString(prefix + "_POSITION:" + juce::String(player->getPosition()) + "\n");
+        stream->writeString(prefix + "_POSITION_SAMPLE:" + juce::String(player->getPositionInSamples()) + "\n");
         stream->writeString(prefix + "_VOLUME:" + juce::String(player->getCurrentVolume()) + "\n");
         stream->writeString(prefix + "_SPEED:" + juce::String(player->getSpeed()) + "\n");
         stream->writeString(prefix + "_MUTED:" + (player->getIsMuted() ? "1" : "0") + "\n");
         stream->writeString(prefix + "_LOOPING:" + (player->isLoopingEnabled() ? "1" : "0") + "\n");
         stream->writeString(prefix + "_MARKER_A:" + juce::String(player->getMarkerATime()) + "\n");
         stream->writeString(prefix + "_MARKER_B:" + juce::String(player->getMarkerBTime()) + "\n");
+        stream->writeString(prefix + "_MARKER_A_SAMPLE:" + juce::String(player->getMarkerASample()) + "\n");
+        stream->writeString(prefix + "_MARKER_B_SAMPLE:" + juce::String(player->getMarkerBSample()) + "\n");
         stream->writeString(prefix + "_AB_LOOP_ACTIVE:" + (player->isABLoopActive() ? "1" : "0") + "\n");
         stream->writeString(prefix + "_TRACK_MARKERS_COUNT:" + juce::String(player->getMarkerCount()) + "\n");
         for (int i = 0; i < player->getMarkerCount(); ++i) {
             stream->writeString(prefix + "_TRACK_MARKER_" + juce::String(i) + ":" + juce::String(player->getMarkerTime(i)) + "\n");
+            stream->writeString(prefix + "_TRACK_MARKER_SAMPLE_" + juce::String(i) + ":" + juce::String(player->getMarkerSample(i)) + "\n");
         }
     };
 
     savePlayerState(playerAudioLeft, "LEFT");
     savePlayerState(playerAudioRight, "RIGHT");
     
+    stream->writeString("TRACK_CACHE_MB:" + juce::String(trackCacheSizesMB[juce::jmax(1, trackCacheBox.getSelectedId()) - 1]) + "\n");
     stream->writeString("PLAYLIST_COUNT:" + juce::String(playlist.size()) + "\n");
     for (const auto& file : playlist) {
         stream->writeString("PLAYLIST_FILE:" + file.getFullPathName() + "\n");
@@ -1162,6 +1470,9 @@ void PlayerGui::loadSession(const juce::File& sessionFile)
             else if (line.startsWith(prefix + "_POSITION:")) {
                 data.position = line.substring(prefix.length() + 10).getDoubleValue();
             }
+            else if (line.startsWith(prefix + "_POSITION_SAMPLE:")) {
+                data.positionSample = line.substring(prefix.length() + 17).getLargeIntValue();
+            }
             else if (line.startsWith(prefix + "_VOLUME:")) {
                 data.volume = line.substring(prefix.length() + 8).getFloatValue();
             }
@@ -1180,12 +1491,19 @@ void PlayerGui::loadSession(const juce::File& sessionFile)
             else if (line.startsWith(prefix + "_MARKER_B:")) {
                 data.markerB = line.substring(prefix.length() + 10).getDoubleValue();
             }
+            else if (line.startsWith(prefix + "_MARKER_A_SAMPLE:")) {
+                data.markerASample = line.substring(prefix.length() + 17).getLargeIntValue();
+            }
+            else if (line.startsWith(prefix + "_MARKER_B_SAMPLE:")) {
+                data.markerBSample = line.substring(prefix.length() + 17).getLargeIntValue();
+            }
             else if (line.startsWith(prefix + "_AB_LOOP_ACTIVE:")) {
                 data.abLoopActive = line.substring(prefix.length() + 16).getIntValue() != 0;
             }
             else if (line.startsWith(prefix + "_TRACK_MARKERS_COUNT:")) {
                 int count = line.substring(prefix.length() + 21).getIntValue();
                 data.trackMarkers.clear();
+                data.trackMarkerSamples.clear();
                 for (int i = 0; i < count; ++i) {
                     for (const auto& markerLine : allLines) {
                         if (markerLine.startsWith(prefix + "_TRACK_MARKER_" + juce::String(i) + ":")) {
@@ -1194,6 +1512,12 @@ void PlayerGui::loadSession(const juce::File& sessionFile)
                             break;
                         }
                     }
+                    for (const auto& markerLine : allLines) {
+                        if (markerLine.startsWith(prefix + "_TRACK_MARKER_SAMPLE_" + juce::String(i) + ":")) {
+                            data.trackMarkerSamples.add(markerLine.fromFirstOccurrenceOf(":", false, false).getLargeIntValue());
+                            break;
+                        }
+                    }
                 }
             }
         }
@@ -1202,6 +1526,11 @@ void PlayerGui::loadSession(const juce::File& sessionFile)
     loadPlayerState(sessionDataLeft, "LEFT");
     loadPlayerState(sessionDataRight, "RIGHT");
     
+    sessionTrackCacheMB = 0;
+    for (const auto& line : allLines)
+        if (line.startsWith("TRACK_CACHE_MB:"))
+            sessionTrackCacheMB = line.substring(15).getIntValue();
+
     playlist.clear();
     for (const auto& line : allLines) {
         if (line.startsWith("PLAYLIST_COUNT:")) {
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include <JuceHeader.h>
 #include "PlayerAudio.h"
+#include "Crossfader.h"
 
 class PlayerAudio;
 class PlayerGui;
@@ -28,7 +29,7 @@ public:
     {
         setVisible(true);
         setEnabled(true);
-        if (mode == ListMode::Playlist || mode == ListMode::PlaylistLeft || mode == ListMode::PlaylistRight) {
+        if (mode == ListMode::Playlist) {
             actionButton.setVisible(false);
             actionButton.setEnabled(false);
             playLeftButton.setButtonText("Play L");
@@ -45,7 +46,8 @@ public:
             addAndMakeVisible(&playRightButton);
         }
         else {
-            actionButton.setButtonText("Load");
+            // a deck's own queue plays the entry on that deck
+            actionButton.setButtonText(mode == ListMode::Markers ? "Load" : "Play");
             actionButton.setVisible(true);
             actionButton.setEnabled(true);
         }
@@ -54,7 +56,7 @@ public:
         removeButton.setLookAndFeel(&bigButtonLookAndFeel);
         actionButton.addListener(this);
         removeButton.addListener(this);
-        if (mode != ListMode::Playlist && mode != ListMode::PlaylistLeft && mode != ListMode::PlaylistRight) {
+        if (mode != ListMode::Playlist) {
             addAndMakeVisible(&actionButton);
         }
         addAndMakeVisible(&removeButton);
@@ -76,7 +78,7 @@ public:
         int playButtonWidth = 70;
         int playButtonHeight = getHeight() - 4;
         int buttonArea;
-        if (rowMode == ListMode::Playlist || rowMode == ListMode::PlaylistLeft || rowMode == ListMode::PlaylistRight) {
+        if (rowMode == ListMode::Playlist) {
             buttonArea = playButtonWidth + playButtonWidth + removeWidth + 6;
             removeButton.setBounds(getWidth() - removeWidth, 2, removeWidth, removeHeight);
             playRightButton.setBounds(getWidth() - removeWidth - playButtonWidth - 2, 2, playButtonWidth, playButtonHeight);
@@ -204,12 +206,41 @@ public:
         markersListModelLeft.playerGui = this;
         markersListModelRight.playerAudio = audioRight;
         markersListModelRight.playerGui = this;
+        queueListModelLeft.playerAudio = audioLeft;
+        queueListModelRight.playerAudio = audioRight;
+
+        audioLeft->onTrackChanged = [this]() {
+            updateMetadataLeft();
+            updateMarkersListLeft();
+            updateQueueLeft();
+        };
+        audioRight->onTrackChanged = [this]() {
+            updateMetadataRight();
+            updateMarkersListRight();
+            updateQueueRight();
+        };
 
         PlaylistBox.setModel(&playlistListModel);
         markersListBoxLeft.setModel(&markersListModelLeft);
         markersListBoxRight.setModel(&markersListModelRight);
+        queueListBoxLeft.setModel(&queueListModelLeft);
+        queueListBoxRight.setModel(&queueListModelRight);
     }
 
+    void setCrossfader(Crossfader* fader) {
+        crossfader = fader;
+        if (crossfader != nullptr) {
+            mixSlider.setValue(crossfader->getPosition(), juce::dontSendNotification);
+            crossfaderCurveBox.setSelectedId((int)crossfader->getCurve() + 1, juce::dontSendNotification);
+        }
+    }
+
+    // asks the owner to start both decks on the same sample
+    std::function<void()> onSyncPlay;
+    std::function<void(bool)> onLimiterToggled;
+    // bytes, 0 turns the cache off
+    std::function<void(juce::int64)> onTrackCacheBudgetChanged;
+
     void updateMarkersListLeft() {
         markersListBoxLeft.updateContent();
         markersListBoxLeft.repaint();
@@ -225,6 +256,16 @@ public:
         PlaylistBox.repaint();
     }
 
+    void updateQueueLeft() {
+        queueListBoxLeft.updateContent();
+        queueListBoxLeft.repaint();
+    }
+
+    void updateQueueRight() {
+        queueListBoxRight.updateContent();
+        queueListBoxRight.repaint();
+    }
+
     void updateMetadataLeft() {
         if (playerAudioLeft != nullptr) {
             juce::String metadata = "Currently playing:\n" + playerAudioLeft->getMetadataInfo();
@@ -282,8 +323,20 @@ private:
     juce::ImageButton setMarkerButtonLeft;
     juce::ImageButton forward10sButtonLeft;
     juce::ImageButton backward10sButtonLeft;
+    // low, mid, high, filter
+    std::array<juce::Slider, 4> toneKnobsLeft;
+    // one per DeckEffectChain::Effect, laid out in chain order
+    std::array<juce::TextButton, DeckEffectChain::numEffects> effectButtonsLeft;
+    juce::TextButton reverseButtonLeft{ "REV" };
 
     juce::Slider mixSlider;
+    juce::ComboBox crossfaderCurveBox;
+    juce::TextButton syncPlayButton{ "Sync Play" };
+    juce::ToggleButton limiterButton{ "Limiter" };
+    // decoded-track cache size; off unless picked here or restored from the session
+    juce::ComboBox trackCacheBox;
+    static constexpr int trackCacheSizesMB[] = { 0, 512, 1024, 2048, 4096 };
+    Crossfader* crossfader = nullptr;
 
 
     juce::ImageButton loadButtonRight;
@@ -312,6 +365,9 @@ private:
     juce::ImageButton setMarkerButtonRight;
     juce::ImageButton forward10sButtonRight;
     juce::ImageButton backward10sButtonRight;
+    std::array<juce::Slider, 4> toneKnobsRight;
+    std::array<juce::TextButton, DeckEffectChain::numEffects> effectButtonsRight;
+    juce::TextButton reverseButtonRight{ "REV" };
 
     juce::ImageButton loadFilesButton;
     juce::ListBox PlaylistBox;
@@ -320,12 +376,23 @@ private:
     ListModel markersListModelLeft{ nullptr, nullptr, this, ListMode::Markers };
     ListModel markersListModelRight{ nullptr, nullptr, this, ListMode::Markers };
     ListModel playlistListModel{ nullptr, nullptr, this, ListMode::Playlist };
+    // what each deck plays through, under its markers
+    juce::ListBox queueListBoxLeft;
+    juce::ListBox queueListBoxRight;
+    ListModel queueListModelLeft{ nullptr, nullptr, this, ListMode::PlaylistLeft };
+    ListModel queueListModelRight{ nullptr, nullptr, this, ListMode::PlaylistRight };
 
 
     juce::TextButton resetLeftButton{ "RESET L" };
     juce::TextButton resetRightButton{ "RESET R" };
     void resetLeftPlayer();
     void resetRightPlayer();
+    void setupToneKnobs(std::array<juce::Slider, 4>& knobs, bool left);
+    void resetToneKnobs(std::array<juce::Slider, 4>& knobs);
+    void setupEffectButtons(std::array<juce::TextButton, DeckEffectChain::numEffects>& buttons, bool left);
+    void refreshEffectButtons(std::array<juce::TextButton, DeckEffectChain::numEffects>& buttons, const PlayerAudio* player);
+    void layoutEffectButtons(std::array<juce::TextButton, DeckEffectChain::numEffects>& buttons,
+        const PlayerAudio* player, int x, int y, int width);
     
     BigButtonLookAndFeel myButtonLookAndFeel;
 
@@ -337,6 +404,11 @@ private:
     void sliderDragStarted(juce::Slider* slider) override;
     void sliderDragEnded(juce::Slider* slider) override;
     void timerCallback() override;
+
+    // the display refreshes quickly while a deck plays or a slider is dragged, slowly otherwise
+    static constexpr int activeTimerInterval = 100;
+    static constexpr int idleTimerInterval = 500;
+    void wakeTimer();
     juce::String formatTime(double seconds);
 
     juce::Image loadIconFromBinary(const void* data, size_t dataSize);
@@ -360,11 +432,17 @@ private:
         double markerB = -1.0;
         bool abLoopActive = false;
         juce::Array<double> trackMarkers;
+        // exact positions in the track's samples; -1 or empty in sessions saved before they existed
+        juce::int64 positionSample = -1;
+        juce::int64 markerASample = -1;
+        juce::int64 markerBSample = -1;
+        juce::Array<juce::int64> trackMarkerSamples;
         bool hasData = false;
     };
     SessionData sessionDataLeft;
     SessionData sessionDataRight;
     bool sessionLoaded = false;
+    int sessionTrackCacheMB = 0;
     juce::File sessionFilePath;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlayerGui)
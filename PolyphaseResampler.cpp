@@ -0,0 +1,327 @@
+#include "PolyphaseResampler.h"
+#include "SimdSupport.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+
+    // one output sample: sum of x[k] * (c[k] + frac * d[k]) for one or two channels sharing
+    // the interpolated coefficients
+    inline float dotScalar(const float* x, const float* c, const float* d, float frac, int taps) {
+        float sum = 0.0f;
+        for (int k = 0; k < taps; ++k)
+            sum += x[k] * (c[k] + frac * d[k]);
+        return sum;
+    }
+
+    struct RenderArgs {
+        const float* const* history;
+        float* const* output;
+        int numChannels;
+        int numOutput;
+        double position;
+        double ratio;
+        int firstTapOffset;
+        int taps;
+        const float* coefficients;
+        const float* deltas;
+    };
+
+    // splits an input position into the base sample, the table row and the weight of the next row
+    inline void locate(const RenderArgs& a, int i, int& start, int& row, float& frac) {
+        const double p = a.position + i * a.ratio;
+        const int base = (int)p;
+        const double phase = (p - base) * PolyphaseResampler::numPhases;
+        row = std::min((int)phase, PolyphaseResampler::numPhases - 1);
+        frac = (float)(phase - row);
+        start = base + a.firstTapOffset;
+    }
+
+    [[maybe_unused]] void renderScalar(const RenderArgs& a) {
+        for (int i = 0; i < a.numOutput; ++i) {
+            int start, row;
+            float frac;
+            locate(a, i, start, row, frac);
+            const float* c = a.coefficients + (size_t)row * a.taps;
+            const float* d = a.deltas + (size_t)row * a.taps;
+
+            for (int ch = 0; ch < a.numChannels; ++ch)
+                a.output[ch][i] = dotScalar(a.history[ch] + start, c, d, frac, a.taps);
+        }
+    }
+
+#if SIMDSUPPORT_X86
+    inline float horizontalSum(__m128 v) {
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_cvtss_f32(v);
+    }
+
+    void renderSse2(const RenderArgs& a) {
+        for (int i = 0; i < a.numOutput; ++i) {
+            int start, row;
+            float frac;
+            locate(a, i, start, row, frac);
+            const float* c = a.coefficients + (size_t)row * a.taps;
+            const float* d = a.deltas + (size_t)row * a.taps;
+            const __m128 f = _mm_set1_ps(frac);
+
+            int ch = 0;
+            for (; ch + 1 < a.numChannels; ch += 2) {
+                const float* x0 = a.history[ch] + start;
+                const float* x1 = a.history[ch + 1] + start;
+                __m128 acc0 = _mm_setzero_ps();
+                __m128 acc1 = _mm_setzero_ps();
+                for (int k = 0; k < a.taps; k += 4) {
+                    const __m128 coef = _mm_add_ps(_mm_loadu_ps(c + k), _mm_mul_ps(f, _mm_loadu_ps(d + k)));
+                    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x0 + k), coef));
+                    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x1 + k), coef));
+                }
+                a.output[ch][i] = horizontalSum(acc0);
+                a.output[ch + 1][i] = horizontalSum(acc1);
+            }
+            for (; ch < a.numChannels; ++ch) {
+                const float* x = a.history[ch] + start;
+                __m128 acc = _mm_setzero_ps();
+                for (int k = 0; k < a.taps; k += 4) {
+                    const __m128 coef = _mm_add_ps(_mm_loadu_ps(c + k), _mm_mul_ps(f, _mm_loadu_ps(d + k)));
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + k), coef));
+                }
+                a.output[ch][i] = horizontalSum(acc);
+            }
+        }
+    }
+
+    SIMDSUPPORT_AVX2 inline float horizontalSum256(__m256 v) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_cvtss_f32(s);
+    }
+
+    SIMDSUPPORT_AVX2 void renderAvx2(const RenderArgs& a) {
+        for (int i = 0; i < a.numOutput; ++i) {
+            int start, row;
+            float frac;
+            locate(a, i, start, row, frac);
+            const float* c = a.coefficients + (size_t)row * a.taps;
+            const float* d = a.deltas + (size_t)row * a.taps;
+            const __m256 f = _mm256_set1_ps(frac);
+
+            int ch = 0;
+            for (; ch + 1 < a.numChannels; ch += 2) {
+                const float* x0 = a.history[ch] + start;
+                const float* x1 = a.history[ch + 1] + start;
+                __m256 acc0 = _mm256_setzero_ps();
+                __m256 acc1 = _mm256_setzero_ps();
+                for (int k = 0; k < a.taps; k += 8) {
+                    const __m256 coef = _mm256_add_ps(_mm256_loadu_ps(c + k), _mm256_mul_ps(f, _mm256_loadu_ps(d + k)));
+                    acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(x0 + k), coef));
+                    acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(x1 + k), coef));
+                }
+                a.output[ch][i] = horizontalSum256(acc0);
+                a.output[ch + 1][i] = horizontalSum256(acc1);
+            }
+            for (; ch < a.numChannels; ++ch) {
+                const float* x = a.history[ch] + start;
+                __m256 acc = _mm256_setzero_ps();
+                for (int k = 0; k < a.taps; k += 8) {
+                    const __m256 coef = _mm256_add_ps(_mm256_loadu_ps(c + k), _mm256_mul_ps(f, _mm256_loadu_ps(d + k)));
+                    acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(x + k), coef));
+                }
+                a.output[ch][i] = horizontalSum256(acc);
+            }
+        }
+    }
+#endif
+}
+
+PolyphaseResampler::Table::Table() {
+    // sized for the largest preset so switching quality or ratio never allocates
+    coefficients.resize((size_t)(numPhases + 1) * maxTaps);
+    deltas.resize((size_t)numPhases * maxTaps);
+    build(quality, ratio);
+}
+
+void PolyphaseResampler::Table::build(Quality newQuality, double inputPerOutput) {
+    quality = newQuality;
+    ratio = inputPerOutput;
+    numTaps = getTapsFor(quality);
+    const int half = numTaps / 2;
+    const double cutoff = 0.5 * getPassbandFor(quality) * std::min(1.0, 1.0 / ratio);
+
+    for (int row = 0; row <= numPhases; ++row) {
+        float* c = coefficients.data() + (size_t)row * numTaps;
+        const double frac = (double)row / numPhases;
+        double sum = 0.0;
+
+        for (int k = 0; k < numTaps; ++k) {
+            const double t = (k - half + 1) - frac;
+            const double x = 2.0 * cutoff * t;
+            const double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(pi * x) / (pi * x);
+            const double w = t / half;
+            const double window = std::abs(w) >= 1.0 ? 0.0
+                : 0.35875 + 0.48829 * std::cos(pi * w) + 0.14128 * std::cos(2.0 * pi * w) + 0.01168 * std::cos(3.0 * pi * w);
+            const double h = sinc * window;
+            c[k] = (float)h;
+            sum += h;
+        }
+
+        // unity gain at DC for every phase
+        for (int k = 0; k < numTaps; ++k)
+            c[k] = (float)(c[k] / sum);
+    }
+
+    for (int row = 0; row < numPhases; ++row)
+        for (int k = 0; k < numTaps; ++k)
+            deltas[(size_t)row * numTaps + k] = coefficients[(size_t)(row + 1) * numTaps + k] - coefficients[(size_t)row * numTaps + k];
+}
+
+// the cutoff only depends on the ratio when downsampling
+bool PolyphaseResampler::Table::suits(double inputPerOutput) const {
+    return std::max(1.0, ratio) == std::max(1.0, inputPerOutput);
+}
+
+PolyphaseResampler::PolyphaseResampler()
+    : table(std::make_unique<Table>()) {
+}
+
+int PolyphaseResampler::getTapsFor(Quality q) {
+    switch (q) {
+    case Quality::Low:    return 16;
+    case Quality::High:   return 96;
+    case Quality::Medium:
+    default:              return 48;
+    }
+}
+
+// -6 dB point as a fraction of the lower Nyquist frequency. Chosen so that the window's
+// transition band ends at Nyquist (Low lets a little through to save taps).
+double PolyphaseResampler::getPassbandFor(Quality q) {
+    switch (q) {
+    case Quality::Low:    return 0.80;
+    case Quality::High:   return 0.95;
+    case Quality::Medium:
+    default:              return 0.90;
+    }
+}
+
+void PolyphaseResampler::prepare(int channels, int maxOutputPerCall) {
+    numChannels = std::max(1, channels);
+    maxOutput = std::max(1, maxOutputPerCall);
+    historyCapacity = maxTaps + (int)std::ceil(maxOutput * maxRatio) + 16;
+
+    history.resize((size_t)numChannels);
+    for (auto& h : history)
+        h.assign((size_t)historyCapacity, 0.0f);
+
+    reset();
+}
+
+void PolyphaseResampler::setRatio(double inputPerOutput) {
+    inputPerOutput = std::min(maxRatio, std::max(minRatio, inputPerOutput));
+    if (inputPerOutput == ratio)
+        return;
+
+    ratio = inputPerOutput;
+    if (!table->suits(ratio))
+        table->build(table->quality, ratio);
+}
+
+void PolyphaseResampler::setQuality(Quality newQuality) {
+    if (newQuality == table->quality)
+        return;
+
+    const int oldTaps = table->numTaps;
+    table->build(newQuality, ratio);
+    adaptHistory(oldTaps);
+}
+
+std::unique_ptr<PolyphaseResampler::Table> PolyphaseResampler::swapTable(std::unique_ptr<Table> newTable) {
+    if (newTable == nullptr)
+        return newTable;
+
+    if (!newTable->suits(ratio))
+        newTable->build(newTable->quality, ratio);
+
+    const int oldTaps = table->numTaps;
+    std::swap(table, newTable);
+    adaptHistory(oldTaps);
+    return newTable;
+}
+
+// Every filter is centred between the same two history samples, so only the reach into
+// the past changes. process() keeps enough for the longest filter; only right after a
+// reset can a longer one reach before the start, and then the history moves up and the
+// missing samples come in as the silence reset() assumes.
+void PolyphaseResampler::adaptHistory(int oldTaps) {
+    const int shift = std::min(table->numTaps / 2 - oldTaps / 2, historyCapacity - filled);
+    if (shift <= 0)
+        return;
+
+    for (auto& h : history) {
+        std::memmove(h.data() + shift, h.data(), sizeof(float) * (size_t)filled);
+        std::fill(h.begin(), h.begin() + shift, 0.0f);
+    }
+    filled += shift;
+    position += shift;
+}
+
+void PolyphaseResampler::reset() {
+    const int half = table->numTaps / 2;
+    for (auto& h : history)
+        std::fill(h.begin(), h.end(), 0.0f);
+
+    // the first input sample lands where the filter is centred on it
+    filled = half - 1;
+    position = half - 1;
+}
+
+int PolyphaseResampler::getInputNeeded(int numOutput) const {
+    if (numOutput <= 0)
+        return 0;
+
+    const int half = table->numTaps / 2;
+    const int lastBase = (int)(position + (numOutput - 1) * ratio);
+    return std::max(0, lastBase + half + 1 - filled);
+}
+
+void PolyphaseResampler::process(const float* const* input, int numInput, float* const* output, int numOutput) {
+    const int half = table->numTaps / 2;
+
+    numInput = std::min(numInput, historyCapacity - filled);
+    for (int ch = 0; ch < numChannels; ++ch)
+        std::memcpy(history[(size_t)ch].data() + filled, input[ch], sizeof(float) * (size_t)numInput);
+    filled += numInput;
+
+    const float* historyPointers[16];
+    const int channels = std::min(numChannels, 16);
+    for (int ch = 0; ch < channels; ++ch)
+        historyPointers[ch] = history[(size_t)ch].data();
+
+    RenderArgs args{ historyPointers, output, channels, numOutput, position, ratio,
+        1 - half, table->numTaps, table->coefficients.data(), table->deltas.data() };
+
+   #if SIMDSUPPORT_X86
+    if (SimdSupport::hasAvx2())
+        renderAvx2(args);
+    else
+        renderSse2(args);
+   #else
+    renderScalar(args);
+   #endif
+
+    position += numOutput * ratio;
+
+    // keep what the longest filter's taps could still reach, so a switch to it has real history
+    const int drop = std::min(filled, (int)position + 1 - maxTaps / 2);
+    if (drop > 0) {
+        for (auto& h : history)
+            std::memmove(h.data(), h.data() + drop, sizeof(float) * (size_t)(filled - drop));
+        filled -= drop;
+        position -= drop;
+    }
+}
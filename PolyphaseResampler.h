@@ -0,0 +1,83 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+// Band-limited sample-rate converter: a Blackman-Harris windowed sinc stored as a
+// polyphase table, with linear interpolation between neighbouring phases so any ratio
+// works. The inner product runs on SSE2 or AVX2 when available. Free of JUCE so the
+// benchmark can build it on its own.
+//
+// Streaming use: ask getInputNeeded() for a block, hand exactly that much input to
+// process(), get the requested number of output samples back.
+class PolyphaseResampler
+{
+public:
+    enum class Quality {
+        Low,    // 16 taps, for many decks on a weak machine
+        Medium, // 48 taps
+        High    // 96 taps, no audible aliasing on bright material
+    };
+
+    static constexpr int numPhases = 128;
+    static constexpr int maxTaps = 96;
+    static constexpr double minRatio = 0.125;
+    static constexpr double maxRatio = 8.0;
+
+    // the coefficients for one quality and cutoff, so a new one can be built on another
+    // thread while the old one plays; sized for maxTaps, so rebuilding never allocates
+    struct Table {
+        Table();
+        // the cutoff follows the ratio when downsampling
+        void build(Quality newQuality, double inputPerOutput);
+        bool suits(double inputPerOutput) const;
+
+        Quality quality = Quality::Medium;
+        double ratio = 1.0;
+        int numTaps = 48;
+
+        // (numPhases + 1) rows of numTaps coefficients, and the row-to-row differences
+        std::vector<float> coefficients;
+        std::vector<float> deltas;
+    };
+
+    PolyphaseResampler();
+
+    // allocates; call before the first process() and whenever the limits grow
+    void prepare(int numChannels, int maxOutputPerCall);
+
+    // input samples consumed per output sample, e.g. 44100.0 / 48000.0;
+    // both rebuild the table when the cutoff moves, so call them off the hot path
+    void setRatio(double inputPerOutput);
+    void setQuality(Quality newQuality);
+    double getRatio() const { return ratio; }
+    Quality getQuality() const { return table->quality; }
+    int getNumTaps() const { return table->numTaps; }
+
+    // switches to a table built elsewhere and hands back the one used until now; the
+    // signal history is kept, so the output carries on without a gap. Allocation free,
+    // unless the table was built for a cutoff the current ratio no longer has.
+    std::unique_ptr<Table> swapTable(std::unique_ptr<Table> newTable);
+
+    // forgets the signal history; the next output starts from silence
+    void reset();
+
+    int getInputNeeded(int numOutput) const;
+    void process(const float* const* input, int numInput, float* const* output, int numOutput);
+
+private:
+    static int getTapsFor(Quality q);
+    static double getPassbandFor(Quality q);
+
+    // lines the history up with a filter of a different length
+    void adaptHistory(int oldTaps);
+
+    int numChannels = 0;
+    int maxOutput = 0;
+    double ratio = 1.0;
+    std::unique_ptr<Table> table;
+
+    std::vector<std::vector<float>> history;
+    int historyCapacity = 0;
+    int filled = 0;
+    double position = 0.0;
+};
@@ -0,0 +1,112 @@
+#include "PolyphaseResamplingAudioSource.h"
+
+PolyphaseResamplingAudioSource::PolyphaseResamplingAudioSource(juce::AudioSource* inputSource, int numChannels)
+    : input(inputSource),
+      numberOfChannels(juce::jmax(1, numChannels))
+{
+    jassert(input != nullptr);
+}
+
+PolyphaseResamplingAudioSource::~PolyphaseResamplingAudioSource() {
+    std::unique_ptr<Table> pending(pendingTable.exchange(nullptr));
+    std::unique_ptr<Table> retired(retiredTable.exchange(nullptr));
+}
+
+void PolyphaseResamplingAudioSource::setQuality(Quality newQuality) {
+    // the table the audio thread gave back, or one it has not picked up yet
+    std::unique_ptr<Table> table(retiredTable.exchange(nullptr));
+    if (table == nullptr)
+        table.reset(pendingTable.exchange(nullptr));
+    if (table == nullptr)
+        table = std::make_unique<Table>();
+
+    // for the rate playing now; the audio thread rebuilds it only if the rate moves meanwhile
+    const double rate = sourceSampleRate.load();
+    const double outputRate = outputSampleRate.load();
+    const double ratio = rate > 0.0 && outputRate > 0.0 ? rate / outputRate : 1.0;
+    table->build(newQuality, juce::jlimit(PolyphaseResampler::minRatio, PolyphaseResampler::maxRatio, ratio));
+
+    requestedQuality = newQuality;
+    std::unique_ptr<Table> superseded(pendingTable.exchange(table.release()));
+}
+
+void PolyphaseResamplingAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    outputSampleRate = sampleRate;
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    // large enough for a chunk at the steepest ratio, so the callback never allocates
+    resampler.prepare(numberOfChannels, chunkSize);
+    inputBuffer.setSize(numberOfChannels, (int)std::ceil(chunkSize * PolyphaseResampler::maxRatio) + PolyphaseResampler::maxTaps + 16,
+        false, true, false);
+
+    resetRequested = true;
+}
+
+void PolyphaseResamplingAudioSource::releaseResources() {
+    input->releaseResources();
+    inputBuffer.setSize(0, 0);
+}
+
+// Audio thread. A new quality arrives as a ready-built table and keeps the filter history.
+// A new ratio still rebuilds the table here when it moves the cutoff, which only happens
+// when a track with a different rate starts.
+void PolyphaseResamplingAudioSource::syncSettings() {
+    const double rate = sourceSampleRate.load();
+    const double outputRate = outputSampleRate.load();
+    const bool shouldBypass = rate <= 0.0 || outputRate <= 0.0 || rate == outputRate;
+
+    if (!shouldBypass)
+        resampler.setRatio(rate / outputRate);
+
+    if (retiredTable.load() == nullptr)
+        if (auto* table = pendingTable.exchange(nullptr))
+            retiredTable = resampler.swapTable(std::unique_ptr<Table>(table)).release();
+
+    if (shouldBypass != bypassed) {
+        bypassed = shouldBypass;
+        resampler.reset();
+    }
+
+    if (resetRequested.exchange(false))
+        resampler.reset();
+}
+
+void PolyphaseResamplingAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    if (inputBuffer.getNumSamples() == 0) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    syncSettings();
+
+    if (bypassed) {
+        input->getNextAudioBlock(bufferToFill);
+        return;
+    }
+
+    auto& dest = *bufferToFill.buffer;
+    jassert(dest.getNumChannels() >= numberOfChannels && numberOfChannels <= 16);
+
+    float* outputs[16];
+    int done = 0;
+
+    while (done < bufferToFill.numSamples) {
+        const int num = juce::jmin(chunkSize, bufferToFill.numSamples - done);
+        const int needed = resampler.getInputNeeded(num);
+
+        if (needed > 0) {
+            juce::AudioSourceChannelInfo info(&inputBuffer, 0, needed);
+            input->getNextAudioBlock(info);
+        }
+
+        for (int ch = 0; ch < numberOfChannels; ++ch)
+            outputs[ch] = dest.getWritePointer(ch, bufferToFill.startSample + done);
+
+        resampler.process(inputBuffer.getArrayOfReadPointers(), needed, outputs, num);
+        done += num;
+    }
+
+    // a mono deck still fills every device channel
+    for (int ch = numberOfChannels; ch < dest.getNumChannels(); ++ch)
+        dest.copyFrom(ch, bufferToFill.startSample, dest, 0, bufferToFill.startSample, bufferToFill.numSamples);
+}
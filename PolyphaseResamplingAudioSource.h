@@ -0,0 +1,58 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PolyphaseResampler.h"
+
+// Converts its input from the file's sample rate to the device rate with the deck's
+// polyphase resampler. Rate and quality can change while playing; the audio thread
+// picks them up at the start of the next block. A new quality's table is built by the
+// caller and only swapped in by the audio thread, which keeps playing through the change.
+class PolyphaseResamplingAudioSource : public juce::AudioSource
+{
+public:
+    using Quality = PolyphaseResampler::Quality;
+
+    explicit PolyphaseResamplingAudioSource(juce::AudioSource* inputSource, int numChannels = 2);
+    ~PolyphaseResamplingAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    // the rate the input delivers; equal to the device rate means the input passes straight through
+    void setSourceSampleRate(double rate) { sourceSampleRate = rate; }
+    double getSourceSampleRate() const { return sourceSampleRate.load(); }
+
+    // message thread; builds the new table before the audio thread sees it
+    void setQuality(Quality newQuality);
+    Quality getQuality() const { return requestedQuality.load(); }
+
+    // drops the filter history, e.g. after the input was repositioned
+    void reset() { resetRequested = true; }
+
+    static constexpr int chunkSize = 1024;
+
+private:
+    void syncSettings();
+
+    juce::AudioSource* input;
+    int numberOfChannels;
+
+    using Table = PolyphaseResampler::Table;
+
+    std::atomic<double> sourceSampleRate{ 0.0 };
+    std::atomic<Quality> requestedQuality{ Quality::Medium };
+    std::atomic<bool> resetRequested{ true };
+
+    // built on the message thread and waiting for the audio thread, and the one the audio
+    // thread swapped out, for the message thread to build the next into. The audio thread
+    // only swaps while nothing is waiting to be taken back, so it never frees one.
+    std::atomic<Table*> pendingTable{ nullptr };
+    std::atomic<Table*> retiredTable{ nullptr };
+
+    std::atomic<double> outputSampleRate{ 0.0 };
+    bool bypassed = true;
+    PolyphaseResampler resampler;
+    juce::AudioBuffer<float> inputBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphaseResamplingAudioSource)
+};
@@ -0,0 +1,357 @@
+#include "ReadAheadAudioSource.h"
+#include <algorithm>
+
+ReadAheadAudioSource::ReadAheadAudioSource(juce::PositionableAudioSource* sourceToBuffer,
+    juce::TimeSliceThread& thread,
+    int samplesToBuffer,
+    int numChannels)
+    : source(sourceToBuffer),
+      backgroundThread(thread),
+      numberOfSamplesToBuffer(juce::jmax(1024, samplesToBuffer)),
+      numberOfChannels(juce::jmax(1, numChannels))
+{
+    jassert(source != nullptr);
+}
+
+ReadAheadAudioSource::~ReadAheadAudioSource() {
+    releaseResources();
+}
+
+void ReadAheadAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    isPrepared = false;
+    backgroundThread.removeTimeSliceClient(this);
+
+    source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    chunkSize = juce::jmax(2048, samplesPerBlockExpected);
+    numberOfSamplesToBuffer = juce::jmax(numberOfSamplesToBuffer, samplesPerBlockExpected * 2);
+    // every backward chunk costs the decoder a seek, so they are bigger than the forward ones
+    reverseChunkSize = juce::jmax(chunkSize, juce::jmin(chunkSize * 4, getReverseReadLimit()));
+    ringBuffer.setSize(numberOfChannels, numberOfSamplesToBuffer, false, true, false);
+    readBuffer.setSize(numberOfChannels, reverseChunkSize, false, true, false);
+
+    {
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        validStart = validEnd = nextPlayPos.load();
+    }
+    seekPending = true;
+    isPrepared = true;
+
+    backgroundThread.addTimeSliceClient(this);
+}
+
+void ReadAheadAudioSource::releaseResources() {
+    isPrepared = false;
+    backgroundThread.removeTimeSliceClient(this);
+
+    ringBuffer.setSize(0, 0);
+    readBuffer.setSize(0, 0);
+    source->releaseResources();
+}
+
+void ReadAheadAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    if (!isPrepared) {
+        bufferToFill.clearActiveBufferRegion();
+        lastBlockComplete = false;
+        return;
+    }
+
+    juce::int64 pos = nextPlayPos.load();
+    juce::int64 start, end;
+    {
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        start = validStart;
+        end = validEnd;
+    }
+
+    const int numSamples = bufferToFill.numSamples;
+    const int validFrom = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, start - pos);
+    const int validTo = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, end - pos);
+
+    auto* dest = bufferToFill.buffer;
+    const int destStart = bufferToFill.startSample;
+
+    if (validFrom >= validTo) {
+        bufferToFill.clearActiveBufferRegion();
+    }
+    else {
+        if (validFrom > 0)
+            dest->clear(destStart, validFrom);
+        if (validTo < numSamples)
+            dest->clear(destStart + validTo, numSamples - validTo);
+
+        const int ringSize = ringBuffer.getNumSamples();
+        const int ringPos = (int)((pos + validFrom) % ringSize);
+        const int numValid = validTo - validFrom;
+        const int firstPart = juce::jmin(numValid, ringSize - ringPos);
+
+        for (int ch = 0; ch < dest->getNumChannels(); ++ch) {
+            const int srcCh = juce::jmin(ch, numberOfChannels - 1);
+            dest->copyFrom(ch, destStart + validFrom, ringBuffer, srcCh, ringPos, firstPart);
+            if (numValid > firstPart)
+                dest->copyFrom(ch, destStart + validFrom + firstPart, ringBuffer, srcCh, 0, numValid - firstPart);
+        }
+    }
+
+    int covered = validFrom == 0 ? validTo : 0;
+
+    // a jump onto a hot cue, before the background thread has moved the ring there
+    if (covered < numSamples) {
+        const int fromCue = readFromCue(pos, bufferToFill);
+        if (fromCue > 0)
+            covered = validFrom <= fromCue && validFrom < validTo ? juce::jmax(fromCue, validTo) : fromCue;
+    }
+
+    lastBlockComplete = covered == numSamples;
+
+    if (!lastBlockComplete) {
+        // misses straight after a seek are expected; anything else means the disk fell behind
+        if (!seekPending)
+            ++underrunCount;
+        backgroundThread.notify();
+    }
+    else {
+        seekPending = false;
+    }
+
+    // a seek from another thread in the meantime takes precedence over advancing
+    nextPlayPos.compare_exchange_strong(pos, pos + numSamples);
+}
+
+// Audio thread: copies what a ready window holds from pos on. Never waits for the lock;
+// the background thread only holds it to copy a window into the ring or to retire one.
+int ReadAheadAudioSource::readFromCue(juce::int64 pos, const juce::AudioSourceChannelInfo& bufferToFill) {
+    const juce::SpinLock::ScopedTryLockType sl(cueLock);
+    if (!sl.isLocked())
+        return 0;
+
+    for (const auto& cue : cues) {
+        if (cue.start < 0 || pos < cue.start || pos >= cue.start + cue.length)
+            continue;
+
+        const int offset = (int)(pos - cue.start);
+        const int numSamples = juce::jmin(bufferToFill.numSamples, cue.length - offset);
+        for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+            bufferToFill.buffer->copyFrom(ch, bufferToFill.startSample, cue.samples,
+                juce::jmin(ch, numberOfChannels - 1), offset, numSamples);
+        return numSamples;
+    }
+    return 0;
+}
+
+void ReadAheadAudioSource::setNextReadPosition(juce::int64 newPosition) {
+    newPosition = juce::jmax((juce::int64)0, newPosition);
+
+    bool inRange;
+    {
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        inRange = newPosition >= validStart && newPosition < validEnd;
+    }
+
+    seekPending = !inRange;
+    nextPlayPos = newPosition;
+
+    if (!inRange)
+        backgroundThread.notify();
+}
+
+int ReadAheadAudioSource::getNumBufferedSamples() const {
+    const juce::int64 pos = nextPlayPos.load();
+    const juce::SpinLock::ScopedLockType sl(rangeLock);
+    if (pos < validStart)
+        return 0;
+    return (int)juce::jlimit((juce::int64)0, (juce::int64)numberOfSamplesToBuffer, validEnd - pos);
+}
+
+double ReadAheadAudioSource::getFillLevel() const {
+    return numberOfSamplesToBuffer > 0 ? getNumBufferedSamples() / (double)numberOfSamplesToBuffer : 0.0;
+}
+
+int ReadAheadAudioSource::useTimeSlice() {
+    if (!isPrepared)
+        return 100;
+
+    if (readNextChunk() || fillNextCue())
+        return 1;
+    return 20;
+}
+
+void ReadAheadAudioSource::setCuePoints(const juce::Array<juce::int64>& startSamples, int windowLength) {
+    {
+        const juce::ScopedLock sl(cueRequestLock);
+        requestedCues.clearQuick();
+        for (auto start : startSamples)
+            if (start >= 0 && requestedCues.size() < maxCues)
+                requestedCues.addIfNotAlreadyThere(start);
+        requestedCueLength = juce::jmax(0, windowLength);
+    }
+
+    ++cueGeneration;
+    backgroundThread.notify();
+}
+
+// Background thread, once the ring is full: retires windows no longer asked for and
+// decodes one missing window per call.
+bool ReadAheadAudioSource::fillNextCue() {
+    const int generation = cueGeneration.load();
+    if (generation == filledCueGeneration)
+        return false;
+
+    juce::Array<juce::int64> wanted;
+    int length;
+    {
+        const juce::ScopedLock sl(cueRequestLock);
+        wanted = requestedCues;
+        length = requestedCueLength;
+    }
+
+    for (auto& cue : cues) {
+        if (cue.start >= 0 && (!wanted.contains(cue.start) || cue.samples.getNumSamples() != length)) {
+            const juce::SpinLock::ScopedLockType sl(cueLock);
+            cue.start = -1;
+        }
+    }
+
+    const juce::int64 total = source->getTotalLength();
+    for (auto start : wanted) {
+        const int numSamples = (int)juce::jmin((juce::int64)length, total - start);
+        const auto matches = [start](const CueWindow& cue) { return cue.start == start; };
+        if (numSamples <= 0 || std::any_of(cues.begin(), cues.end(), matches))
+            continue;
+
+        const auto free = std::find_if(cues.begin(), cues.end(), [](const CueWindow& cue) { return cue.start < 0; });
+        if (free == cues.end())
+            break;
+
+        free->samples.setSize(numberOfChannels, length, false, false, true);
+        source->setNextReadPosition(start);
+        juce::AudioSourceChannelInfo info(&free->samples, 0, numSamples);
+        source->getNextAudioBlock(info);
+
+        const juce::SpinLock::ScopedLockType sl(cueLock);
+        free->length = numSamples;
+        free->start = start;
+        return true;
+    }
+
+    filledCueGeneration = generation;
+    return false;
+}
+
+// Background thread, straight after a jump: a window at the new position is copied into
+// the (empty) ring, so decoding resumes where it ends. Returns the new end of the range.
+juce::int64 ReadAheadAudioSource::seedRingFromCue(juce::int64 playPos) {
+    const juce::SpinLock::ScopedLockType cl(cueLock);
+
+    for (const auto& cue : cues) {
+        if (cue.start < 0 || playPos < cue.start || playPos >= cue.start + cue.length)
+            continue;
+
+        const int offset = (int)(playPos - cue.start);
+        const int numSamples = juce::jmin(cue.length - offset, numberOfSamplesToBuffer);
+        writeToRing(playPos, cue.samples, offset, numSamples);
+
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        validEnd = playPos + numSamples;
+        return validEnd;
+    }
+    return playPos;
+}
+
+bool ReadAheadAudioSource::readNextChunk() {
+    if (reverseFlag != nullptr && reverseFlag->load())
+        return readPreviousChunk();
+
+    const juce::int64 playPos = nextPlayPos.load();
+    juce::int64 end;
+    bool jumped = false;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        if (playPos < validStart || playPos > validEnd) {
+            validStart = validEnd = playPos;
+            jumped = true;
+        }
+        end = validEnd;
+    }
+
+    if (jumped)
+        end = seedRingFromCue(playPos);
+
+    const juce::int64 wantedEnd = playPos + numberOfSamplesToBuffer;
+    const int numToRead = (int)juce::jmin((juce::int64)chunkSize, wantedEnd - end);
+    if (numToRead <= 0)
+        return jumped;
+
+    {
+        // retire the ring slots we are about to overwrite before touching them
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        validStart = juce::jmax(validStart, end + numToRead - numberOfSamplesToBuffer);
+    }
+
+    readIntoRing(end, numToRead);
+
+    {
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        validEnd = end + numToRead;
+    }
+
+    return true;
+}
+
+// Backwards: the reader asks for a block starting at the play position, so the buffered
+// range keeps getReverseReadLimit() samples above it and grows downwards below it.
+bool ReadAheadAudioSource::readPreviousChunk() {
+    const juce::int64 playPos = nextPlayPos.load();
+    const juce::int64 top = juce::jmin(playPos + getReverseReadLimit(), source->getTotalLength());
+    juce::int64 start;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        if (playPos < validStart || playPos > validEnd)
+            validStart = validEnd = juce::jmax(playPos, top);
+        start = validStart;
+    }
+
+    const juce::int64 wantedStart = juce::jmax((juce::int64)0, top - numberOfSamplesToBuffer);
+    const int numToRead = (int)juce::jmin((juce::int64)reverseChunkSize, start - wantedStart);
+    if (numToRead <= 0)
+        return false;
+
+    {
+        // retire the top of the range where the ring wraps into it
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        validEnd = juce::jmin(validEnd, start - numToRead + numberOfSamplesToBuffer);
+    }
+
+    readIntoRing(start - numToRead, numToRead);
+
+    {
+        const juce::SpinLock::ScopedLockType sl(rangeLock);
+        validStart = start - numToRead;
+    }
+
+    return true;
+}
+
+void ReadAheadAudioSource::readIntoRing(juce::int64 startSample, int numSamples) {
+    source->setNextReadPosition(startSample);
+
+    juce::AudioSourceChannelInfo info(&readBuffer, 0, numSamples);
+    source->getNextAudioBlock(info);
+
+    writeToRing(startSample, readBuffer, 0, numSamples);
+}
+
+void ReadAheadAudioSource::writeToRing(juce::int64 startSample, const juce::AudioBuffer<float>& from,
+    int fromStart, int numSamples) {
+    const int ringSize = ringBuffer.getNumSamples();
+    const int ringPos = (int)(startSample % ringSize);
+    const int firstPart = juce::jmin(numSamples, ringSize - ringPos);
+
+    for (int ch = 0; ch < numberOfChannels; ++ch) {
+        ringBuffer.copyFrom(ch, ringPos, from, ch, fromStart, firstPart);
+        if (numSamples > firstPart)
+            ringBuffer.copyFrom(ch, 0, from, ch, fromStart + firstPart, numSamples - firstPart);
+    }
+}
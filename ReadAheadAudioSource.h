@@ -0,0 +1,99 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+
+// Buffers a PositionableAudioSource ahead of the play position on a shared
+// TimeSliceThread, so disk reads and decoding never happen inside the audio callback.
+// While the deck plays backwards it buffers below the play position instead, still
+// decoding each chunk forwards.
+//
+// It can also keep short decoded windows at hot cue positions, filled whenever the ring
+// is full. A seek onto one plays from the window straight away, and the ring carries on
+// decoding from where the window ends instead of from the cue itself.
+class ReadAheadAudioSource : public juce::PositionableAudioSource,
+    private juce::TimeSliceClient
+{
+public:
+    ReadAheadAudioSource(juce::PositionableAudioSource* sourceToBuffer,
+        juce::TimeSliceThread& thread,
+        int samplesToBuffer,
+        int numChannels = 2);
+    ~ReadAheadAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override { return nextPlayPos.load(); }
+    juce::int64 getTotalLength() const override { return source->getTotalLength(); }
+    bool isLooping() const override { return source->isLooping(); }
+
+    int getBufferSize() const { return numberOfSamplesToBuffer; }
+    int getNumBufferedSamples() const;
+    double getFillLevel() const;
+    int getUnderrunCount() const { return underrunCount.load(); }
+    bool wasLastBlockComplete() const { return lastBlockComplete; }
+    void resetUnderrunCount() { underrunCount = 0; }
+
+    // buffers below the play position while *flag is set; the flag must outlive this source
+    void setReverseFlag(const std::atomic<bool>* flag) { reverseFlag = flag; }
+
+    // in reverse, reads may start this far below the top of the buffered range
+    int getReverseReadLimit() const { return numberOfSamplesToBuffer / 4; }
+
+    // message thread; windows of windowLength samples starting at each position, up to
+    // maxCues of them. Windows no longer listed are dropped on the background thread.
+    void setCuePoints(const juce::Array<juce::int64>& startSamples, int windowLength);
+    static constexpr int maxCues = 16;
+
+private:
+    struct CueWindow {
+        juce::AudioBuffer<float> samples;
+        juce::int64 start = -1;
+        int length = 0;
+    };
+
+    int useTimeSlice() override;
+    bool readNextChunk();
+    bool readPreviousChunk();
+    void readIntoRing(juce::int64 startSample, int numSamples);
+    void writeToRing(juce::int64 startSample, const juce::AudioBuffer<float>& from, int fromStart, int numSamples);
+    bool fillNextCue();
+    juce::int64 seedRingFromCue(juce::int64 playPos);
+    int readFromCue(juce::int64 pos, const juce::AudioSourceChannelInfo& bufferToFill);
+
+    juce::PositionableAudioSource* source;
+    juce::TimeSliceThread& backgroundThread;
+    int numberOfSamplesToBuffer;
+    int numberOfChannels;
+    int chunkSize = 2048;
+    int reverseChunkSize = 8192;
+    const std::atomic<bool>* reverseFlag = nullptr;
+
+    juce::AudioBuffer<float> ringBuffer;
+    juce::AudioBuffer<float> readBuffer;
+
+    mutable juce::SpinLock rangeLock;
+    juce::int64 validStart = 0;
+    juce::int64 validEnd = 0;
+    bool lastBlockComplete = true;
+
+    std::atomic<juce::int64> nextPlayPos{ 0 };
+    std::atomic<bool> seekPending{ false };
+    std::atomic<bool> isPrepared{ false };
+    std::atomic<int> underrunCount{ 0 };
+
+    // a window is readable while its start is set; the background thread clears the start
+    // under cueLock before reusing its buffer
+    std::array<CueWindow, maxCues> cues;
+    juce::SpinLock cueLock;
+
+    juce::CriticalSection cueRequestLock;
+    juce::Array<juce::int64> requestedCues;
+    int requestedCueLength = 0;
+    std::atomic<int> cueGeneration{ 0 };
+    int filledCueGeneration = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReadAheadAudioSource)
+};
@@ -0,0 +1,144 @@
+#include "ReversibleAudioSource.h"
+
+ReversibleAudioSource::ReversibleAudioSource(TrackQueueAudioSource* queueToReverse, int numChannels)
+    : queue(queueToReverse),
+      numberOfChannels(juce::jmax(1, numChannels))
+{
+    jassert(queue != nullptr);
+}
+
+ReversibleAudioSource::~ReversibleAudioSource() {
+}
+
+void ReversibleAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    queue->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    cache.setSize(numberOfChannels, cacheSize, false, true, false);
+    cacheStart = cacheEnd = 0;
+}
+
+void ReversibleAudioSource::releaseResources() {
+    queue->releaseResources();
+
+    cache.setSize(0, 0);
+    cacheStart = cacheEnd = 0;
+}
+
+void ReversibleAudioSource::setNextReadPosition(juce::int64 newPosition) {
+    newPosition = juce::jmax((juce::int64)0, newPosition);
+
+    // the forward chain follows along, so switching back carries on from here
+    queue->setNextReadPosition(newPosition);
+    position = newPosition;
+    cacheStart = cacheEnd = 0;
+}
+
+juce::int64 ReversibleAudioSource::getNextReadPosition() const {
+    return reversed.load() ? position.load() : queue->getNextReadPosition();
+}
+
+void ReversibleAudioSource::setReversed(bool shouldReverse) {
+    if (shouldReverse == reversed.load())
+        return;
+
+    if (shouldReverse) {
+        position = queue->getNextReadPosition();
+        cacheStart = cacheEnd = 0;
+    }
+    else {
+        queue->setNextReadPosition(position.load());
+    }
+
+    reachedStart = false;
+    reversed = shouldReverse;
+}
+
+void ReversibleAudioSource::setLoopRange(juce::int64 startSample, juce::int64 endSample) {
+    const juce::SpinLock::ScopedLockType sl(settingsLock);
+    requestedStart = startSample;
+    requestedEnd = endSample;
+}
+
+void ReversibleAudioSource::setLoopEnabled(bool shouldLoop) {
+    requestedEnabled = shouldLoop;
+}
+
+void ReversibleAudioSource::syncLoopSettings() {
+    const juce::SpinLock::ScopedTryLockType sl(settingsLock);
+    if (!sl.isLocked())
+        return;
+
+    loopStart = requestedStart;
+    loopEnd = requestedEnd;
+    loopActive = requestedEnabled.load() && loopEnd > loopStart && loopStart >= 0;
+}
+
+void ReversibleAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    if (!reversed.load()) {
+        queue->getNextAudioBlock(bufferToFill);
+        return;
+    }
+
+    syncLoopSettings();
+    renderReversed(bufferToFill);
+}
+
+void ReversibleAudioSource::renderReversed(const juce::AudioSourceChannelInfo& bufferToFill) {
+    auto* track = queue->getCurrent();
+    if (track == nullptr) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    auto& dest = *bufferToFill.buffer;
+    const juce::int64 lowest = loopActive ? loopStart : 0;
+    juce::int64 pos = juce::jmin(position.load(), track->getTotalLength());
+
+    // entering the loop from outside lands on its end, as a forward pass would land on its start
+    if (loopActive && (pos <= loopStart || pos > loopEnd))
+        pos = loopEnd;
+
+    reachedStart = false;
+    int done = 0;
+
+    while (done < bufferToFill.numSamples) {
+        if (pos <= lowest) {
+            if (!loopActive) {
+                dest.clear(bufferToFill.startSample + done, bufferToFill.numSamples - done);
+                reachedStart = true;
+                break;
+            }
+            pos = loopEnd;
+        }
+
+        if (pos - 1 < cacheStart || pos > cacheEnd)
+            fillCache(*track, pos, lowest);
+
+        // a loop moved since the cache was filled may start above it
+        const juce::int64 bottom = juce::jmax(cacheStart, lowest);
+        const int count = (int)juce::jmin((juce::int64)(bufferToFill.numSamples - done), pos - bottom);
+        const int top = (int)(pos - cacheStart) - 1;
+
+        for (int ch = 0; ch < dest.getNumChannels(); ++ch) {
+            const float* src = cache.getReadPointer(juce::jmin(ch, numberOfChannels - 1));
+            float* out = dest.getWritePointer(ch, bufferToFill.startSample + done);
+            for (int i = 0; i < count; ++i)
+                out[i] = src[top - i];
+        }
+
+        pos -= count;
+        done += count;
+    }
+
+    position = pos;
+}
+
+// reads the chunk that ends at `end` forwards, never below `lowest`
+void ReversibleAudioSource::fillCache(juce::PositionableAudioSource& track, juce::int64 end, juce::int64 lowest) {
+    cacheEnd = end;
+    cacheStart = juce::jmax(lowest, end - (juce::int64)maxChunk.load());
+
+    track.setNextReadPosition(cacheStart);
+    juce::AudioSourceChannelInfo info(&cache, 0, (int)(cacheEnd - cacheStart));
+    track.getNextAudioBlock(info);
+}
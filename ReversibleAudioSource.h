@@ -0,0 +1,73 @@
+#pragma once
+#include <JuceHeader.h>
+#include "TrackQueueAudioSource.h"
+
+// Sits between the track queue and the transport and, when reversed, plays the current
+// track backwards from the same position. The track is read forwards in chunks into a
+// small cache that is then emitted back to front, so the decoder only ever seeks once
+// per chunk; with a read-ahead stage below, that stage buffers backwards as well.
+//
+// An active loop wraps from its start back to its end. Reaching the start of the track
+// with no loop gives silence and sets hasReachedStart(). Loop seams are not crossfaded
+// in reverse.
+class ReversibleAudioSource : public juce::PositionableAudioSource
+{
+public:
+    explicit ReversibleAudioSource(TrackQueueAudioSource* queue, int numChannels = 2);
+    ~ReversibleAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override { return queue->getTotalLength(); }
+    bool isLooping() const override { return queue->isLooping(); }
+
+    // audio thread, between blocks
+    void setReversed(bool shouldReverse);
+    // read by the read-ahead stages to pick their direction
+    const std::atomic<bool>& getReversedFlag() const { return reversed; }
+    bool isReversed() const { return reversed.load(); }
+    bool hasReachedStart() const { return reachedStart; }
+
+    // caps the forward read per chunk, e.g. to what a read-ahead stage keeps above the play position
+    void setMaxChunkSize(int numSamples) { maxChunk = juce::jlimit(256, cacheSize, numSamples); }
+
+    // message thread; mirrors the loop handed to LoopingAudioSource
+    void setLoopRange(juce::int64 startSample, juce::int64 endSample);
+    void setLoopEnabled(bool shouldLoop);
+
+    static constexpr int cacheSize = 4096;
+
+private:
+    void syncLoopSettings();
+    void renderReversed(const juce::AudioSourceChannelInfo& bufferToFill);
+    void fillCache(juce::PositionableAudioSource& track, juce::int64 end, juce::int64 lowest);
+
+    TrackQueueAudioSource* queue;
+    int numberOfChannels;
+
+    std::atomic<bool> reversed{ false };
+    std::atomic<juce::int64> position{ 0 };
+    bool reachedStart = false;
+    std::atomic<int> maxChunk{ cacheSize };
+
+    // source samples [cacheStart, cacheEnd), in forward order
+    juce::AudioBuffer<float> cache;
+    juce::int64 cacheStart = 0;
+    juce::int64 cacheEnd = 0;
+
+    // audio-thread copies of the loop settings
+    juce::int64 loopStart = 0;
+    juce::int64 loopEnd = 0;
+    bool loopActive = false;
+
+    juce::SpinLock settingsLock;
+    juce::int64 requestedStart = 0;
+    juce::int64 requestedEnd = 0;
+    std::atomic<bool> requestedEnabled{ false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReversibleAudioSource)
+};
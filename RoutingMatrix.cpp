@@ -0,0 +1,95 @@
+#include "RoutingMatrix.h"
+#include <algorithm>
+
+RoutingMatrix::RoutingMatrix(int decks)
+    : numDecks(std::max(1, decks)),
+      targets(new std::atomic<float>[(size_t)(numDecks * maxDeckChannels * maxOutputs)]),
+      current(new float[(size_t)(numDecks * maxDeckChannels * maxOutputs)])
+{
+    resetToStereo();
+
+    // nothing to glide from on the first block
+    for (int i = 0; i < numDecks * maxDeckChannels * maxOutputs; ++i)
+        current[(size_t)i] = targets[(size_t)i].load(std::memory_order_relaxed);
+}
+
+bool RoutingMatrix::isValid(int deck, int deckChannel, int output) const {
+    return deck >= 0 && deck < numDecks && deckChannel >= 0 && deckChannel < maxDeckChannels
+        && output >= 0 && output < maxOutputs;
+}
+
+void RoutingMatrix::setGain(int deck, int deckChannel, int output, float gain) {
+    if (isValid(deck, deckChannel, output))
+        targets[(size_t)indexOf(deck, deckChannel, output)].store(std::max(0.0f, gain), std::memory_order_relaxed);
+}
+
+float RoutingMatrix::getGain(int deck, int deckChannel, int output) const {
+    return isValid(deck, deckChannel, output)
+        ? targets[(size_t)indexOf(deck, deckChannel, output)].load(std::memory_order_relaxed) : 0.0f;
+}
+
+void RoutingMatrix::clearDeck(int deck) {
+    for (int ch = 0; ch < maxDeckChannels; ++ch)
+        for (int out = 0; out < maxOutputs; ++out)
+            setGain(deck, ch, out, 0.0f);
+}
+
+void RoutingMatrix::clear() {
+    for (int deck = 0; deck < numDecks; ++deck)
+        clearDeck(deck);
+}
+
+void RoutingMatrix::resetToStereo() {
+    clear();
+    for (int deck = 0; deck < numDecks; ++deck)
+        for (int ch = 0; ch < maxDeckChannels; ++ch)
+            setGain(deck, ch, ch, 1.0f);
+}
+
+void RoutingMatrix::mixDeck(int deck, const float* const* deckChannels, int numDeckChannels,
+                            float* const* outputs, int numOutputs, int numSamples) {
+    if (deck < 0 || deck >= numDecks || numSamples <= 0)
+        return;
+
+    numDeckChannels = std::min(numDeckChannels, maxDeckChannels);
+    numOutputs = std::min(numOutputs, maxOutputs);
+
+    for (int ch = 0; ch < numDeckChannels; ++ch) {
+        for (int out = 0; out < numOutputs; ++out) {
+            const GainRamp::Block block = advanceRoute((size_t)indexOf(deck, ch, out), numSamples);
+            if (block.start == 0.0f && block.end == 0.0f)
+                continue;
+
+            GainRamp::add(block, outputs[out], deckChannels[ch], numSamples);
+        }
+    }
+}
+
+void RoutingMatrix::advanceDeck(int deck, int numOutputs, int numSamples, MixKernels::Gain* gains, int rowStride) {
+    if (deck < 0 || deck >= numDecks || numSamples <= 0)
+        return;
+
+    numOutputs = std::min(numOutputs, maxOutputs);
+
+    for (int out = 0; out < numOutputs; ++out) {
+        for (int ch = 0; ch < maxDeckChannels; ++ch) {
+            const GainRamp::Block block = advanceRoute((size_t)indexOf(deck, ch, out), numSamples);
+            gains[out * rowStride + ch].start = block.start;
+            gains[out * rowStride + ch].step = block.step;
+        }
+    }
+}
+
+GainRamp::Block RoutingMatrix::advanceRoute(size_t index, int numSamples) {
+    const float target = targets[index].load(std::memory_order_relaxed);
+
+    GainRamp::Block block;
+    block.start = current[index];
+    block.end = target;
+    if (target != current[index]) {
+        block.step = (target - current[index]) / (float)numSamples;
+        block.rampLength = numSamples;
+        current[index] = target;
+    }
+    return block;
+}
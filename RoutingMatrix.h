@@ -0,0 +1,54 @@
+#pragma once
+#include "GainRamp.h"
+#include "MixKernels.h"
+#include <atomic>
+#include <memory>
+
+// Sends every channel of every deck to any device output with its own gain, so one
+// process can feed several zones. Gains are set from any thread; the audio thread picks
+// them up at the start of a block and glides each one that changed across that block,
+// so re-routing never clicks. The mix runs on GainRamp's SSE2/AVX2 kernels straight over
+// the caller's buffers and nothing is allocated after construction. Free of JUCE so the
+// benchmark can build it on its own.
+class RoutingMatrix
+{
+public:
+    // decks render stereo
+    static constexpr int maxDeckChannels = 2;
+    // as many as the master limiter handles
+    static constexpr int maxOutputs = 32;
+
+    // every deck starts on the first two outputs, left to left and right to right
+    explicit RoutingMatrix(int numDecks);
+
+    int getNumDecks() const { return numDecks; }
+
+    void setGain(int deck, int deckChannel, int output, float gain);
+    float getGain(int deck, int deckChannel, int output) const;
+    // silences every route of one deck, or of all of them
+    void clearDeck(int deck);
+    void clear();
+    void resetToStereo();
+
+    // audio thread: outputs[o] += deckChannels[c] * gain(c, o) for the first numOutputs
+    // outputs; any fader gain is expected to be on deckChannels already
+    void mixDeck(int deck, const float* const* deckChannels, int numDeckChannels,
+                 float* const* outputs, int numOutputs, int numSamples);
+    // audio thread: the same gains for one deck, for MixKernels, written to
+    // gains[output * rowStride + deckChannel]; moves on as mixDeck() would
+    void advanceDeck(int deck, int numOutputs, int numSamples, MixKernels::Gain* gains, int rowStride);
+
+private:
+    int indexOf(int deck, int deckChannel, int output) const {
+        return (deck * maxDeckChannels + deckChannel) * maxOutputs + output;
+    }
+    bool isValid(int deck, int deckChannel, int output) const;
+    // glides the route at index across the next numSamples samples
+    GainRamp::Block advanceRoute(size_t index, int numSamples);
+
+    int numDecks = 0;
+
+    // what the message thread asked for, and what the audio thread last applied
+    std::unique_ptr<std::atomic<float>[]> targets;
+    std::unique_ptr<float[]> current;
+};
@@ -0,0 +1,44 @@
+#include "SimdSupport.h"
+
+#if SIMDSUPPORT_X86 && defined(_MSC_VER) && !defined(__clang__)
+ #include <intrin.h>
+#endif
+
+namespace SimdSupport
+{
+namespace
+{
+    bool detectAvx2() {
+       #if !SIMDSUPPORT_X86
+        return false;
+       #elif defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // the OS must also save the YMM registers on context switches
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+       #else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+       #endif
+    }
+}
+
+bool isX86() {
+    return SIMDSUPPORT_X86 != 0;
+}
+
+bool hasAvx2() {
+    static const bool avx2 = detectAvx2();
+    return avx2;
+}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// Which vector instruction sets the running CPU and OS support, detected once. Shared by
+// the hand-vectorised DSP kernels so each of them dispatches the same way. Free of JUCE
+// so the standalone benchmarks can build it.
+namespace SimdSupport
+{
+    // x86 only; SSE2 is the baseline there and is assumed whenever this is true
+    bool isX86();
+    bool hasAvx2();
+}
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define SIMDSUPPORT_X86 1
+ #include <immintrin.h>
+ #if defined(_MSC_VER) && !defined(__clang__)
+  #define SIMDSUPPORT_AVX2
+ #else
+  // lets one function use AVX2 while the rest of the file stays at the baseline
+  #define SIMDSUPPORT_AVX2 __attribute__((target("avx2")))
+ #endif
+#else
+ #define SIMDSUPPORT_X86 0
+#endif
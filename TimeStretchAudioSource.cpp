@@ -0,0 +1,195 @@
+#include "TimeStretchAudioSource.h"
+
+TimeStretchAudioSource::TimeStretchAudioSource(juce::AudioSource* inputSource, int numChannels)
+    : input(inputSource),
+      numberOfChannels(juce::jmax(1, numChannels))
+{
+    jassert(input != nullptr);
+}
+
+TimeStretchAudioSource::~TimeStretchAudioSource() {
+}
+
+TimeStretchAudioSource::QualitySettings TimeStretchAudioSource::getSettings(Quality q) {
+    switch (q) {
+    case Quality::Low:    return { 1024, 256, 8 };
+    case Quality::High:   return { 4096, 768, 2 };
+    case Quality::Medium:
+    default:              return { 2048, 512, 4 };
+    }
+}
+
+void TimeStretchAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    // sized for the most expensive tier so switching quality never allocates
+    const auto largest = getSettings(Quality::High);
+    const int inputCapacity = 3 * largest.frameSize + 2 * largest.searchRadius + 64;
+
+    inputBuffer.setSize(numberOfChannels, inputCapacity, false, true, false);
+    overlapBuffer.setSize(numberOfChannels, largest.frameSize, false, true, false);
+    outputBuffer.setSize(numberOfChannels, largest.frameSize / 2, false, true, false);
+    window.allocate((size_t)largest.frameSize, true);
+
+    resetRequested = true;
+}
+
+void TimeStretchAudioSource::releaseResources() {
+    input->releaseResources();
+
+    inputBuffer.setSize(0, 0);
+    overlapBuffer.setSize(0, 0);
+    outputBuffer.setSize(0, 0);
+    window.free();
+}
+
+void TimeStretchAudioSource::setQuality(Quality newQuality) {
+    if (requestedQuality.exchange(newQuality) != newQuality)
+        resetRequested = true;
+}
+
+void TimeStretchAudioSource::resetState() {
+    const auto settings = getSettings(requestedQuality.load());
+    frameSize = settings.frameSize;
+    hopSize = frameSize / 2;
+    searchRadius = settings.searchRadius;
+    coarseStep = settings.coarseStep;
+
+    // periodic Hann: two frames at 50% overlap sum to exactly one
+    for (int i = 0; i < frameSize; ++i)
+        window[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)i / (float)frameSize);
+
+    inputBuffer.clear();
+    overlapBuffer.clear();
+    outputBuffer.clear();
+    inputCount = 0;
+    outputCount = 0;
+    analysisPos = 0.0;
+    previousFramePos = 0;
+    hasPreviousFrame = false;
+}
+
+void TimeStretchAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    if (window == nullptr) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    if (resetRequested.exchange(false))
+        resetState();
+
+    auto& dest = *bufferToFill.buffer;
+    int done = 0;
+
+    while (done < bufferToFill.numSamples) {
+        if (outputCount == 0)
+            processFrame();
+
+        const int num = juce::jmin(bufferToFill.numSamples - done, outputCount);
+
+        for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+            dest.copyFrom(ch, bufferToFill.startSample + done, outputBuffer, juce::jmin(ch, numberOfChannels - 1), hopSize - outputCount, num);
+
+        outputCount -= num;
+        done += num;
+    }
+}
+
+void TimeStretchAudioSource::processFrame() {
+    const double currentSpeed = speed.load();
+    const int nominal = (int)std::lround(analysisPos);
+    const int target = previousFramePos + hopSize;
+
+    int required = nominal + searchRadius + frameSize;
+    if (hasPreviousFrame)
+        required = juce::jmax(required, target + frameSize);
+    pullInput(required);
+
+    int framePos = nominal;
+    if (hasPreviousFrame && nominal != target)
+        framePos = findBestFramePosition(target, nominal);
+
+    for (int ch = 0; ch < numberOfChannels; ++ch) {
+        auto* overlap = overlapBuffer.getWritePointer(ch);
+        const auto* in = inputBuffer.getReadPointer(ch, framePos);
+        juce::FloatVectorOperations::addWithMultiply(overlap, in, window.get(), frameSize);
+
+        // the first half is complete now; emit it and slide the second half down
+        outputBuffer.copyFrom(ch, 0, overlapBuffer, ch, 0, hopSize);
+        std::memmove(overlap, overlap + hopSize, sizeof(float) * (size_t)hopSize);
+        juce::FloatVectorOperations::clear(overlap + hopSize, hopSize);
+    }
+    outputCount = hopSize;
+
+    previousFramePos = framePos;
+    hasPreviousFrame = true;
+    analysisPos += hopSize * currentSpeed;
+
+    // drop input that no future frame or search window can reach
+    const int discard = juce::jlimit(0, inputCount,
+        juce::jmin(previousFramePos + hopSize, (int)analysisPos - searchRadius));
+    if (discard > 0) {
+        for (int ch = 0; ch < numberOfChannels; ++ch) {
+            auto* data = inputBuffer.getWritePointer(ch);
+            std::memmove(data, data + discard, sizeof(float) * (size_t)(inputCount - discard));
+        }
+        inputCount -= discard;
+        previousFramePos -= discard;
+        analysisPos -= discard;
+    }
+}
+
+void TimeStretchAudioSource::pullInput(int required) {
+    jassert(required <= inputBuffer.getNumSamples());
+    required = juce::jmin(required, inputBuffer.getNumSamples());
+
+    if (inputCount >= required)
+        return;
+
+    juce::AudioSourceChannelInfo info(&inputBuffer, inputCount, required - inputCount);
+    input->getNextAudioBlock(info);
+    inputCount = required;
+}
+
+int TimeStretchAudioSource::findBestFramePosition(int target, int nominal) const {
+    const int lo = juce::jmax(0, nominal - searchRadius);
+    const int hi = juce::jmin(nominal + searchRadius, inputCount - frameSize);
+    if (hi <= lo)
+        return juce::jlimit(0, juce::jmax(0, inputCount - frameSize), nominal);
+
+    int best = lo;
+    float bestScore = -std::numeric_limits<float>::max();
+
+    for (int candidate = lo; candidate <= hi; candidate += coarseStep) {
+        const float score = correlate(target, candidate);
+        if (score > bestScore) {
+            bestScore = score;
+            best = candidate;
+        }
+    }
+
+    const int refineLo = juce::jmax(lo, best - coarseStep + 1);
+    const int refineHi = juce::jmin(hi, best + coarseStep - 1);
+    for (int candidate = refineLo; candidate <= refineHi; ++candidate) {
+        const float score = correlate(target, candidate);
+        if (score > bestScore) {
+            bestScore = score;
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+// Similarity of the natural continuation of the last frame with a candidate frame,
+// measured over the half that will be overlap-added.
+float TimeStretchAudioSource::correlate(int a, int b) const {
+    float sum = 0.0f;
+    for (int ch = 0; ch < numberOfChannels; ++ch) {
+        const auto* x = inputBuffer.getReadPointer(ch, a);
+        const auto* y = inputBuffer.getReadPointer(ch, b);
+        for (int i = 0; i < hopSize; ++i)
+            sum += x[i] * y[i];
+    }
+    return sum;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Real-time WSOLA time-stretcher. Changes tempo without changing pitch, and the
+// speed can be moved continuously while playing without tearing down the source.
+class TimeStretchAudioSource : public juce::AudioSource
+{
+public:
+    enum class Quality {
+        Low,
+        Medium,
+        High
+    };
+
+    explicit TimeStretchAudioSource(juce::AudioSource* inputSource, int numChannels = 2);
+    ~TimeStretchAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setSpeed(double newSpeed) { speed = juce::jlimit(minSpeed, maxSpeed, newSpeed); }
+    double getSpeed() const { return speed.load(); }
+
+    // takes effect at the next block, together with a reset of the overlap state
+    void setQuality(Quality newQuality);
+    Quality getQuality() const { return requestedQuality.load(); }
+
+    // drops buffered audio, e.g. after the input was repositioned
+    void reset() { resetRequested = true; }
+
+    int getLatencySamples() const { return frameSize; }
+
+    static constexpr double minSpeed = 0.25;
+    static constexpr double maxSpeed = 4.0;
+
+private:
+    struct QualitySettings {
+        int frameSize;
+        int searchRadius;
+        int coarseStep;
+    };
+    static QualitySettings getSettings(Quality q);
+
+    void resetState();
+    void processFrame();
+    void pullInput(int required);
+    int findBestFramePosition(int target, int nominal) const;
+    float correlate(int a, int b) const;
+
+    juce::AudioSource* input;
+    int numberOfChannels;
+
+    std::atomic<double> speed{ 1.0 };
+    std::atomic<Quality> requestedQuality{ Quality::Medium };
+    std::atomic<bool> resetRequested{ true };
+
+    int frameSize = 0;
+    int hopSize = 0;
+    int searchRadius = 0;
+    int coarseStep = 1;
+
+    juce::AudioBuffer<float> inputBuffer;
+    int inputCount = 0;
+    double analysisPos = 0.0;
+    int previousFramePos = 0;
+    bool hasPreviousFrame = false;
+
+    juce::AudioBuffer<float> overlapBuffer;
+    juce::AudioBuffer<float> outputBuffer;
+    int outputCount = 0;
+    juce::HeapBlock<float> window;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimeStretchAudioSource)
+};
@@ -0,0 +1,76 @@
+#include "TrackQueueAudioSource.h"
+
+TrackQueueAudioSource::TrackQueueAudioSource() {
+}
+
+TrackQueueAudioSource::~TrackQueueAudioSource() {
+}
+
+void TrackQueueAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    if (auto* source = current.load())
+        source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void TrackQueueAudioSource::releaseResources() {
+    if (auto* source = current.load())
+        source->releaseResources();
+}
+
+void TrackQueueAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    auto* source = current.load();
+    if (source == nullptr) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    const juce::int64 remaining = source->getTotalLength() - source->getNextReadPosition();
+    juce::PositionableAudioSource* following = nullptr;
+
+    // exchange, so a concurrent takeNext() and this switch can never both own the next track
+    if (!source->isLooping() && remaining <= bufferToFill.numSamples)
+        following = next.exchange(nullptr);
+
+    if (following == nullptr) {
+        source->getNextAudioBlock(bufferToFill);
+        return;
+    }
+
+    // the current track ends inside this block: splice the next one in at the exact sample
+    const int fromCurrent = (int)juce::jlimit((juce::int64)0, (juce::int64)bufferToFill.numSamples, remaining);
+    if (fromCurrent > 0) {
+        juce::AudioSourceChannelInfo head(bufferToFill.buffer, bufferToFill.startSample, fromCurrent);
+        source->getNextAudioBlock(head);
+    }
+
+    current = following;
+
+    if (fromCurrent < bufferToFill.numSamples) {
+        juce::AudioSourceChannelInfo tail(bufferToFill.buffer, bufferToFill.startSample + fromCurrent,
+            bufferToFill.numSamples - fromCurrent);
+        following->getNextAudioBlock(tail);
+    }
+
+    advanced = true;
+    if (onAdvance)
+        onAdvance();
+}
+
+void TrackQueueAudioSource::setNextReadPosition(juce::int64 newPosition) {
+    if (auto* source = current.load())
+        source->setNextReadPosition(newPosition);
+}
+
+juce::int64 TrackQueueAudioSource::getNextReadPosition() const {
+    auto* source = current.load();
+    return source != nullptr ? source->getNextReadPosition() : 0;
+}
+
+juce::int64 TrackQueueAudioSource::getTotalLength() const {
+    auto* source = current.load();
+    return source != nullptr ? source->getTotalLength() : 0;
+}
+
+bool TrackQueueAudioSource::isLooping() const {
+    auto* source = current.load();
+    return source != nullptr && source->isLooping();
+}
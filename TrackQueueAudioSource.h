@@ -0,0 +1,45 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Plays the current track and, when it reaches its last sample, continues with an
+// already prepared next track inside the same block. The audio thread only swaps
+// pointers; opening and priming the next track happens elsewhere.
+class TrackQueueAudioSource : public juce::PositionableAudioSource
+{
+public:
+    TrackQueueAudioSource();
+    ~TrackQueueAudioSource() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    // only while the transport is detached from this source
+    void setCurrent(juce::PositionableAudioSource* source) { current = source; }
+    // audio thread; the track playing now, for reading it directly without the splice
+    juce::PositionableAudioSource* getCurrent() const { return current.load(); }
+
+    // the source must already be prepared and positioned at its first sample
+    void setNext(juce::PositionableAudioSource* source) { next = source; }
+    bool hasNext() const { return next.load() != nullptr; }
+
+    // withdraws the queued track; returns nullptr if the audio thread already switched to it
+    juce::PositionableAudioSource* takeNext() { return next.exchange(nullptr); }
+
+    // true once per switch; the old current source is no longer touched afterwards
+    bool consumeAdvance() { return advanced.exchange(false); }
+
+    std::function<void()> onAdvance;
+
+private:
+    std::atomic<juce::PositionableAudioSource*> current{ nullptr };
+    std::atomic<juce::PositionableAudioSource*> next{ nullptr };
+    std::atomic<bool> advanced{ false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackQueueAudioSource)
+};
@@ -0,0 +1,309 @@
+#include "TruePeakLimiter.h"
+#include "SimdSupport.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr double pi = 3.14159265358979323846;
+    constexpr int lanes = 8;
+    constexpr int taps = TruePeakLimiter::tapsPerPhase;
+    constexpr int phases = TruePeakLimiter::oversampling;
+
+    // below this a sample cannot push anything over any sensible ceiling
+    constexpr float silence = 1.0e-9f;
+
+    inline const float* coefficientAt(const float* interpolator, int phase, int tap) {
+        return interpolator + ((size_t)phase * taps + (size_t)tap) * lanes;
+    }
+
+    // x points at the current chunk, with tapsPerPhase - 1 older samples before it
+    float truePeakScalar(const float* interpolator, const float* x, int i) {
+        float peak = 0.0f;
+        for (int p = 0; p < phases; ++p) {
+            float sum = 0.0f;
+            for (int j = 0; j < taps; ++j)
+                sum += coefficientAt(interpolator, p, j)[0] * x[i - j];
+            peak = std::max(peak, std::abs(sum));
+        }
+        return peak;
+    }
+
+    void detectScalar(const float* interpolator, const float* x, float* peak, int start, int numSamples, bool first) {
+        for (int i = start; i < numSamples; ++i) {
+            const float p = truePeakScalar(interpolator, x, i);
+            peak[i] = first ? p : std::max(peak[i], p);
+        }
+    }
+
+    void gainsScalar(float* peakToGain, float ceiling, int start, int numSamples) {
+        for (int i = start; i < numSamples; ++i)
+            peakToGain[i] = std::min(1.0f, ceiling / std::max(peakToGain[i], silence));
+    }
+
+    void applyScalar(const float* delayed, const float* gain, float* out, int start, int numSamples) {
+        for (int i = start; i < numSamples; ++i)
+            out[i] = delayed[i] * gain[i];
+    }
+
+#if SIMDSUPPORT_X86
+    // four output samples per step: each phase is an FIR over shifted loads of the input
+    void detectSse2(const float* interpolator, const float* x, float* peak, int numSamples, bool first) {
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4) {
+            __m128 m = _mm_setzero_ps();
+            for (int p = 0; p < phases; ++p) {
+                __m128 acc = _mm_setzero_ps();
+                for (int j = 0; j < taps; ++j)
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(coefficientAt(interpolator, p, j)), _mm_loadu_ps(x + i - j)));
+                m = _mm_max_ps(m, _mm_andnot_ps(signMask, acc));
+            }
+            _mm_storeu_ps(peak + i, first ? m : _mm_max_ps(m, _mm_loadu_ps(peak + i)));
+        }
+        detectScalar(interpolator, x, peak, i, numSamples, first);
+    }
+
+    void gainsSse2(float* peakToGain, float ceiling, int numSamples) {
+        const __m128 c = _mm_set1_ps(ceiling);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 floor = _mm_set1_ps(silence);
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            _mm_storeu_ps(peakToGain + i, _mm_min_ps(one, _mm_div_ps(c, _mm_max_ps(_mm_loadu_ps(peakToGain + i), floor))));
+        gainsScalar(peakToGain, ceiling, i, numSamples);
+    }
+
+    void applySse2(const float* delayed, const float* gain, float* out, int numSamples) {
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(delayed + i), _mm_loadu_ps(gain + i)));
+        applyScalar(delayed, gain, out, i, numSamples);
+    }
+
+    SIMDSUPPORT_AVX2 void detectAvx2(const float* interpolator, const float* x, float* peak, int numSamples, bool first) {
+        const __m256 signMask = _mm256_set1_ps(-0.0f);
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8) {
+            __m256 m = _mm256_setzero_ps();
+            for (int p = 0; p < phases; ++p) {
+                __m256 acc = _mm256_setzero_ps();
+                for (int j = 0; j < taps; ++j)
+                    acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_load_ps(coefficientAt(interpolator, p, j)), _mm256_loadu_ps(x + i - j)));
+                m = _mm256_max_ps(m, _mm256_andnot_ps(signMask, acc));
+            }
+            _mm256_storeu_ps(peak + i, first ? m : _mm256_max_ps(m, _mm256_loadu_ps(peak + i)));
+        }
+        detectScalar(interpolator, x, peak, i, numSamples, first);
+    }
+
+    SIMDSUPPORT_AVX2 void gainsAvx2(float* peakToGain, float ceiling, int numSamples) {
+        const __m256 c = _mm256_set1_ps(ceiling);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 floor = _mm256_set1_ps(silence);
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+            _mm256_storeu_ps(peakToGain + i, _mm256_min_ps(one, _mm256_div_ps(c, _mm256_max_ps(_mm256_loadu_ps(peakToGain + i), floor))));
+        gainsScalar(peakToGain, ceiling, i, numSamples);
+    }
+
+    SIMDSUPPORT_AVX2 void applyAvx2(const float* delayed, const float* gain, float* out, int numSamples) {
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(delayed + i), _mm256_loadu_ps(gain + i)));
+        applyScalar(delayed, gain, out, i, numSamples);
+    }
+#endif
+
+    void detectPeaks(const float* interpolator, const float* x, float* peak, int numSamples, bool first) {
+       #if SIMDSUPPORT_X86
+        if (SimdSupport::hasAvx2())
+            detectAvx2(interpolator, x, peak, numSamples, first);
+        else
+            detectSse2(interpolator, x, peak, numSamples, first);
+       #else
+        detectScalar(interpolator, x, peak, 0, numSamples, first);
+       #endif
+    }
+
+    void peaksToGains(float* peakToGain, float ceiling, int numSamples) {
+       #if SIMDSUPPORT_X86
+        if (SimdSupport::hasAvx2())
+            gainsAvx2(peakToGain, ceiling, numSamples);
+        else
+            gainsSse2(peakToGain, ceiling, numSamples);
+       #else
+        gainsScalar(peakToGain, ceiling, 0, numSamples);
+       #endif
+    }
+
+    void applyGains(const float* delayed, const float* gain, float* out, int numSamples) {
+       #if SIMDSUPPORT_X86
+        if (SimdSupport::hasAvx2())
+            applyAvx2(delayed, gain, out, numSamples);
+        else
+            applySse2(delayed, gain, out, numSamples);
+       #else
+        applyScalar(delayed, gain, out, 0, numSamples);
+       #endif
+    }
+}
+
+void TruePeakLimiter::prepare(double newSampleRate, int numChannels, int maxBlockSize, double lookaheadSeconds) {
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    channels = std::max(1, numChannels);
+    maxBlock = std::max(1, maxBlockSize);
+    lookahead = std::max(1, (int)std::lround(lookaheadSeconds * sampleRate));
+    holdLength = getLatencySamples() + 1;
+
+    // 32-byte aligned start so the coefficient loads can be aligned too
+    interpolator.assign((size_t)phases * taps * lanes + lanes, 0.0f);
+    buildInterpolator();
+
+    history.assign((size_t)channels, std::vector<float>((size_t)(taps - 1 + maxBlock), 0.0f));
+    delayLine.assign((size_t)channels, std::vector<float>((size_t)(getLatencySamples() + maxBlock), 0.0f));
+
+    requiredGain.assign((size_t)maxBlock, 1.0f);
+    gain.assign((size_t)maxBlock, 1.0f);
+
+    minIndex.assign((size_t)holdLength, 0);
+    minValue.assign((size_t)holdLength, 1.0f);
+    average.assign((size_t)lookahead, 1.0f);
+
+    setReleaseSeconds(releaseTime);
+    reset();
+}
+
+void TruePeakLimiter::buildInterpolator() {
+    // windowed sinc at the original Nyquist; phase p sits p/4 of a sample after the centre tap
+    const double half = taps / 2;
+    float* base = interpolator.data();
+    while (((size_t)base & 31) != 0)
+        ++base;
+
+    for (int p = 0; p < phases; ++p) {
+        double h[taps];
+        double sum = 0.0;
+        for (int j = 0; j < taps; ++j) {
+            const double t = (j - detectorDelay) + (double)p / phases;
+            const double sinc = std::abs(t) < 1.0e-9 ? 1.0 : std::sin(pi * t) / (pi * t);
+            const double w = t / half;
+            const double window = std::abs(w) >= 1.0 ? 0.0 : 0.42 + 0.5 * std::cos(pi * w) + 0.08 * std::cos(2.0 * pi * w);
+            h[j] = sinc * window;
+            sum += h[j];
+        }
+
+        for (int j = 0; j < taps; ++j)
+            std::fill_n(base + ((size_t)p * taps + j) * lanes, lanes, (float)(h[j] / sum));
+    }
+}
+
+void TruePeakLimiter::setCeilingDb(float ceilingDb) {
+    ceiling = std::pow(10.0f, std::min(0.0f, ceilingDb) / 20.0f);
+}
+
+void TruePeakLimiter::setReleaseSeconds(double releaseSeconds) {
+    releaseTime = std::max(0.001, releaseSeconds);
+    releaseCoefficient = (float)(1.0 - std::exp(-1.0 / (releaseTime * sampleRate)));
+}
+
+float TruePeakLimiter::getLastGainReductionDb() const {
+    return 20.0f * std::log10(std::max(lastMinGain, silence));
+}
+
+void TruePeakLimiter::reset() {
+    for (auto& h : history)
+        std::fill(h.begin(), h.end(), 0.0f);
+    for (auto& d : delayLine)
+        std::fill(d.begin(), d.end(), 0.0f);
+
+    minHead = 0;
+    minCount = 0;
+    sampleCounter = 0;
+    envelope = 1.0f;
+
+    std::fill(average.begin(), average.end(), 1.0f);
+    averageIndex = 0;
+    averageSum = (double)lookahead;
+    lastMinGain = 1.0f;
+}
+
+void TruePeakLimiter::process(float* const* channelData, int numChannels, int numSamples) {
+    if (maxBlock == 0)
+        return;
+
+    numChannels = std::min(numChannels, channels);
+    lastMinGain = 1.0f;
+
+    float* chunk[32];
+    numChannels = std::min(numChannels, 32);
+
+    for (int done = 0; done < numSamples; ) {
+        const int n = std::min(maxBlock, numSamples - done);
+        for (int ch = 0; ch < numChannels; ++ch)
+            chunk[ch] = channelData[ch] + done;
+        processChunk(chunk, numChannels, n);
+        done += n;
+    }
+}
+
+void TruePeakLimiter::processChunk(float* const* channelData, int numChannels, int numSamples) {
+    const float* coefficients = interpolator.data();
+    while (((size_t)coefficients & 31) != 0)
+        ++coefficients;
+
+    const int latency = getLatencySamples();
+
+    // linked across channels: the loudest one sets the gain for all of them
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* h = history[(size_t)ch].data();
+        std::memcpy(h + taps - 1, channelData[ch], sizeof(float) * (size_t)numSamples);
+        detectPeaks(coefficients, h + taps - 1, requiredGain.data(), numSamples, ch == 0);
+        std::memmove(h, h + numSamples, sizeof(float) * (size_t)(taps - 1));
+    }
+
+    peaksToGains(requiredGain.data(), ceiling, numSamples);
+    computeGains(numSamples);
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* d = delayLine[(size_t)ch].data();
+        std::memcpy(d + latency, channelData[ch], sizeof(float) * (size_t)numSamples);
+        applyGains(d, gain.data(), channelData[ch], numSamples);
+        std::memmove(d, d + numSamples, sizeof(float) * (size_t)latency);
+    }
+}
+
+void TruePeakLimiter::computeGains(int numSamples) {
+    const int capacity = holdLength;
+
+    for (int i = 0; i < numSamples; ++i) {
+        const long long index = sampleCounter++;
+        const float required = requiredGain[(size_t)i];
+
+        // drop what fell out of the window, then keep the ring increasing from head to tail
+        if (minCount > 0 && minIndex[(size_t)minHead] <= index - holdLength) {
+            minHead = (minHead + 1) % capacity;
+            --minCount;
+        }
+        while (minCount > 0 && minValue[(size_t)((minHead + minCount - 1) % capacity)] >= required)
+            --minCount;
+        const int tail = (minHead + minCount) % capacity;
+        minIndex[(size_t)tail] = index;
+        minValue[(size_t)tail] = required;
+        ++minCount;
+
+        // down at once, back up with the release time; never above the held minimum
+        const float held = minValue[(size_t)minHead];
+        envelope = held < envelope ? held : envelope + (held - envelope) * releaseCoefficient;
+
+        averageSum += (double)envelope - (double)average[(size_t)averageIndex];
+        average[(size_t)averageIndex] = envelope;
+        if (++averageIndex == lookahead)
+            averageIndex = 0;
+
+        const float g = std::min(1.0f, (float)(averageSum / lookahead));
+        gain[(size_t)i] = g;
+        lastMinGain = std::min(lastMinGain, g);
+    }
+}
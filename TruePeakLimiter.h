@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+
+// Brickwall limiter for the master bus. Peaks are measured between samples too, with a
+// 4x polyphase interpolator in the spirit of ITU-R BS.1770 (but longer, so it reads
+// correctly up to 18 kHz at 48 kHz), and the audio is delayed by a short lookahead so
+// the gain is already down when a peak arrives. The peak detector and the gain stage run
+// on SSE2 or AVX2; every buffer is allocated in prepare(). Free of JUCE so the benchmark
+// can build it on its own.
+//
+// Content right at Nyquist can still be under-read by a fraction of a dB.
+//
+// The gain for a sample is the average over the lookahead of a min-hold of the required
+// gains, which never lets a detected peak exceed the ceiling and ramps smoothly into it.
+// The hold also covers every sample the interpolator reads around a peak, so the gain
+// cannot change underneath it.
+class TruePeakLimiter
+{
+public:
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 24;
+
+    // allocates; call before the first process()
+    void prepare(double sampleRate, int numChannels, int maxBlockSize, double lookaheadSeconds = 0.0015);
+
+    void setCeilingDb(float ceilingDb);
+    void setReleaseSeconds(double releaseSeconds);
+
+    // lookahead plus the interpolator's span on either side of a peak
+    int getLatencySamples() const { return lookahead + 2 * detectorDelay; }
+
+    // lowest gain applied during the last process() call, in dB (0 or below)
+    float getLastGainReductionDb() const;
+
+    // clears the delay lines and recovers to unity gain
+    void reset();
+
+    // in place; numChannels may be fewer than prepared, any extra are left alone
+    void process(float* const* channels, int numChannels, int numSamples);
+
+private:
+    static constexpr int detectorDelay = tapsPerPhase / 2;
+
+    void buildInterpolator();
+    void processChunk(float* const* channels, int numChannels, int numSamples);
+    void computeGains(int numSamples);
+
+    double sampleRate = 44100.0;
+    int channels = 0;
+    int maxBlock = 0;
+    int lookahead = 0;
+    int holdLength = 0;
+    float ceiling = 0.891f;
+    float releaseCoefficient = 0.0f;
+    double releaseTime = 0.1;
+
+    // per phase and tap, each coefficient repeated across eight lanes for broadcast-free loads
+    std::vector<float> interpolator;
+
+    // the last tapsPerPhase - 1 input samples, then the current chunk
+    std::vector<std::vector<float>> history;
+    // lookahead + detector delay samples, then the current chunk
+    std::vector<std::vector<float>> delayLine;
+
+    std::vector<float> requiredGain;
+    std::vector<float> gain;
+
+    // sliding minimum over latency + 1 required gains, as a monotonic ring of (sample, gain)
+    std::vector<long long> minIndex;
+    std::vector<float> minValue;
+    int minHead = 0;
+    int minCount = 0;
+    long long sampleCounter = 0;
+
+    float envelope = 1.0f;
+
+    // running average of the envelope over the lookahead
+    std::vector<float> average;
+    int averageIndex = 0;
+    double averageSum = 0.0;
+
+    float lastMinGain = 1.0f;
+};
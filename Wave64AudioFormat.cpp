@@ -0,0 +1,159 @@
+#include "Wave64AudioFormat.h"
+
+namespace
+{
+    // the first four bytes name the chunk; the other twelve are the same for all of these
+    const juce::uint8 riffGuid[16] = { 'r', 'i', 'f', 'f', 0x2e, 0x91, 0xcf, 0x11, 0xa5, 0xd6, 0x28, 0xdb, 0x04, 0xc1, 0x00, 0x00 };
+    const juce::uint8 waveGuid[16] = { 'w', 'a', 'v', 'e', 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+    const juce::uint8 fmtGuid[16] = { 'f', 'm', 't', ' ', 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+    const juce::uint8 dataGuid[16] = { 'd', 'a', 't', 'a', 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+
+    constexpr int formatPcm = 1;
+    constexpr int formatFloat = 3;
+    constexpr int formatExtensible = 0xfffe;
+}
+
+class Wave64Reader : public juce::AudioFormatReader
+{
+public:
+    explicit Wave64Reader(juce::InputStream* in)
+        : juce::AudioFormatReader(in, "Wave64 file") {
+        juce::uint8 guid[16];
+        if (input->read(guid, 16) != 16 || std::memcmp(guid, riffGuid, 16) != 0)
+            return;
+        input->readInt64();
+        if (input->read(guid, 16) != 16 || std::memcmp(guid, waveGuid, 16) != 0)
+            return;
+
+        bool haveFormat = false;
+        while (!input->isExhausted()) {
+            const juce::int64 chunkStart = input->getPosition();
+            if (input->read(guid, 16) != 16)
+                break;
+
+            // sizes count the 24-byte chunk header; chunks are padded to 8 bytes
+            const juce::int64 chunkSize = input->readInt64();
+            if (chunkSize < 24)
+                break;
+
+            if (std::memcmp(guid, fmtGuid, 16) == 0) {
+                int tag = (juce::uint16)input->readShort();
+                numChannels = (unsigned int)input->readShort();
+                sampleRate = input->readInt();
+                input->readInt();
+                blockAlign = input->readShort();
+                bitsPerSample = (unsigned int)input->readShort();
+
+                if (tag == formatExtensible && chunkSize - 24 >= 40) {
+                    input->readShort();
+                    input->readShort();
+                    input->readInt();
+                    tag = (juce::uint16)input->readShort(); // first two bytes of the sub-format GUID
+                }
+
+                // only widths copySampleData() handles; this also keeps blockAlign non-zero
+                // for the length below
+                const bool supportedWidth = bitsPerSample == 8 || bitsPerSample == 16
+                    || bitsPerSample == 24 || bitsPerSample == 32;
+                usesFloatingPointData = tag == formatFloat;
+                haveFormat = (tag == formatPcm || (tag == formatFloat && bitsPerSample == 32))
+                    && supportedWidth && numChannels > 0 && sampleRate > 0.0 && blockAlign > 0
+                    && blockAlign == (int)(numChannels * bitsPerSample / 8);
+            }
+            else if (std::memcmp(guid, dataGuid, 16) == 0) {
+                dataStart = chunkStart + 24;
+                if (haveFormat)
+                    lengthInSamples = (chunkSize - 24) / blockAlign;
+                break;
+            }
+
+            input->setPosition(chunkStart + ((chunkSize + 7) & ~(juce::int64)7));
+        }
+
+        if (!haveFormat)
+            lengthInSamples = 0;
+    }
+
+    bool isValid() const { return lengthInSamples > 0; }
+
+    bool readSamples(int* const* destSamples, int numDestChannels, int startOffsetInDestBuffer,
+        juce::int64 startSampleInFile, int numSamples) override {
+        clearSamplesBeyondAvailableLength(destSamples, numDestChannels, startOffsetInDestBuffer,
+            startSampleInFile, numSamples, lengthInSamples);
+        if (numSamples <= 0)
+            return true;
+
+        input->setPosition(dataStart + startSampleInFile * blockAlign);
+
+        while (numSamples > 0) {
+            const int numThisTime = juce::jmin(numSamples, blockSamples);
+            const size_t bytes = (size_t)(numThisTime * blockAlign);
+            block.ensureSize(bytes);
+
+            const int bytesRead = input->read(block.getData(), (int)bytes);
+            if (bytesRead < (int)bytes)
+                juce::zeromem(juce::addBytesToPointer(block.getData(), bytesRead), bytes - (size_t)bytesRead);
+
+            copySampleData(destSamples, startOffsetInDestBuffer, numDestChannels, block.getData(), numThisTime);
+            startOffsetInDestBuffer += numThisTime;
+            numSamples -= numThisTime;
+        }
+        return true;
+    }
+
+private:
+    void copySampleData(int* const* dest, int destOffset, int numDestChannels, const void* source, int num) const {
+        const int channels = (int)numChannels;
+        using namespace juce;
+        switch (bitsPerSample) {
+        case 8:  ReadHelper<AudioData::Int32, AudioData::UInt8, AudioData::LittleEndian>::read(dest, destOffset, numDestChannels, source, channels, num); break;
+        case 16: ReadHelper<AudioData::Int32, AudioData::Int16, AudioData::LittleEndian>::read(dest, destOffset, numDestChannels, source, channels, num); break;
+        case 24: ReadHelper<AudioData::Int32, AudioData::Int24, AudioData::LittleEndian>::read(dest, destOffset, numDestChannels, source, channels, num); break;
+        case 32:
+            if (usesFloatingPointData)
+                ReadHelper<AudioData::Float32, AudioData::Float32, AudioData::LittleEndian>::read(dest, destOffset, numDestChannels, source, channels, num);
+            else
+                ReadHelper<AudioData::Int32, AudioData::Int32, AudioData::LittleEndian>::read(dest, destOffset, numDestChannels, source, channels, num);
+            break;
+        default: break;
+        }
+    }
+
+    static constexpr int blockSamples = 8192;
+
+    juce::int64 dataStart = 0;
+    int blockAlign = 0;
+    juce::MemoryBlock block;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Wave64Reader)
+};
+
+Wave64AudioFormat::Wave64AudioFormat()
+    : juce::AudioFormat("Wave64 file", ".w64") {
+}
+
+Wave64AudioFormat::~Wave64AudioFormat() {
+}
+
+juce::Array<int> Wave64AudioFormat::getPossibleSampleRates() {
+    return { 8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000 };
+}
+
+juce::Array<int> Wave64AudioFormat::getPossibleBitDepths() {
+    return { 8, 16, 24, 32 };
+}
+
+juce::AudioFormatReader* Wave64AudioFormat::createReaderFor(juce::InputStream* sourceStream, bool deleteStreamIfOpeningFails) {
+    auto reader = std::make_unique<Wave64Reader>(sourceStream);
+    if (reader->isValid())
+        return reader.release();
+
+    if (!deleteStreamIfOpeningFails)
+        reader->input = nullptr;
+    return nullptr;
+}
+
+juce::AudioFormatWriter* Wave64AudioFormat::createWriterFor(juce::OutputStream*, double, unsigned int, int,
+    const juce::StringPairArray&, int) {
+    return nullptr;
+}
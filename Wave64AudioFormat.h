@@ -0,0 +1,26 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Reads Sony Wave64 (.w64) files: RIFF with GUID chunk ids and 64-bit chunk sizes, so
+// recordings far past the 4 GB WAV limit keep exact sample positions. Integer PCM of 8,
+// 16, 24 or 32 bits and 32-bit float. Reading only; the reader streams from the file
+// and holds no more than one block of it in memory.
+class Wave64AudioFormat : public juce::AudioFormat
+{
+public:
+    Wave64AudioFormat();
+    ~Wave64AudioFormat() override;
+
+    juce::Array<int> getPossibleSampleRates() override;
+    juce::Array<int> getPossibleBitDepths() override;
+    bool canDoStereo() override { return true; }
+    bool canDoMono() override { return true; }
+
+    juce::AudioFormatReader* createReaderFor(juce::InputStream* sourceStream, bool deleteStreamIfOpeningFails) override;
+    juce::AudioFormatWriter* createWriterFor(juce::OutputStream* streamToWriteTo, double sampleRateToUse,
+        unsigned int numberOfChannels, int bitsPerSample, const juce::StringPairArray& metadataValues,
+        int qualityOptionIndex) override;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Wave64AudioFormat)
+};